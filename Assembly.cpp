@@ -0,0 +1,81 @@
+#include "Assembly.h"
+
+long long cell_key(int x, int y)
+{
+	return (long long)x << 32 | (unsigned int)y;
+}
+
+Assembly::Assembly(int piece_count) : m_pieceSlots(piece_count, -1)
+{
+}
+
+void Assembly::place(int piece, int x, int y, int rotation)
+{
+	Placement placement = { piece, x, y, rotation };
+
+	m_pieceSlots[piece] = m_placements.size();
+	m_cells[cell_key(x, y)] = m_placements.size();
+	m_placements.push_back(placement);
+}
+
+bool Assembly::occupied(int x, int y)
+{
+	return m_cells.count(cell_key(x, y)) > 0;
+}
+
+bool Assembly::placed(int piece)
+{
+	return m_pieceSlots[piece] >= 0;
+}
+
+// -1 if the slot is empty
+int Assembly::pieceAt(int x, int y)
+{
+	unordered_map<long long, int>::iterator it = m_cells.find(cell_key(x, y));
+
+	return it == m_cells.end() ? -1 : m_placements[it->second].piece;
+}
+
+Placement& Assembly::placementOf(int piece)
+{
+	return m_placements[m_pieceSlots[piece]];
+}
+
+// Which edge (numbered across all pieces) of the piece in the slot faces
+// the given direction, -1 if the slot is empty.
+int Assembly::facingEdge(int x, int y, int direction)
+{
+	unordered_map<long long, int>::iterator it = m_cells.find(cell_key(x, y));
+
+	if (it == m_cells.end()) return -1;
+
+	Placement& placement = m_placements[it->second];
+
+	return placement.piece * EDGE_COUNT + (direction - placement.rotation + EDGE_COUNT) % EDGE_COUNT;
+}
+
+int Assembly::placedCount()
+{
+	return m_placements.size();
+}
+
+vector<Placement>& Assembly::placements()
+{
+	return m_placements;
+}
+
+Point direction_offset(int direction)
+{
+	switch (direction)
+	{
+		case EDGE_TOP: return Point(0, -1);
+		case EDGE_LEFT: return Point(-1, 0);
+		case EDGE_BOT: return Point(0, 1);
+		default: return Point(1, 0);
+	}
+}
+
+int opposite_direction(int direction)
+{
+	return (direction + 2) % EDGE_COUNT;
+}
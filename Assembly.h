@@ -0,0 +1,50 @@
+#ifndef _ASSEMBLY_
+#define _ASSEMBLY_
+
+#include <vector>
+#include <unordered_map>
+
+#include "PieceData.h"
+
+using namespace std;
+
+// Where a piece went. rotation is in quarter turns anticlockwise, so the
+// piece's edge e faces direction (e + rotation) % 4, directions numbered
+// like the edges (EDGE_TOP, EDGE_LEFT, EDGE_BOT, EDGE_RIGHT).
+struct Placement
+{
+	int piece;
+	int x;
+	int y;
+	int rotation;
+};
+
+// The puzzle as it is put together: pieces placed on an unbounded grid of
+// slots, y increasing downwards.
+class Assembly
+{
+	private:
+		vector<Placement> m_placements;
+		vector<int> m_pieceSlots;
+		unordered_map<long long, int> m_cells;
+
+	public:
+		Assembly(int piece_count);
+
+		void place(int piece, int x, int y, int rotation);
+
+		bool occupied(int x, int y);
+		bool placed(int piece);
+		int pieceAt(int x, int y);
+		Placement& placementOf(int piece);
+		int facingEdge(int x, int y, int direction);
+
+		int placedCount();
+		vector<Placement>& placements();
+};
+
+long long cell_key(int x, int y);
+Point direction_offset(int direction);
+int opposite_direction(int direction);
+
+#endif
@@ -0,0 +1,157 @@
+#include "CandidateGraph.h"
+
+#include <fstream>
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+
+// "i/n", shards numbered from 0
+bool parse_shard(string text, MatchShard& shard)
+{
+	char rest;
+
+	if (sscanf(text.c_str(), "%d/%d%c", &shard.index, &shard.count, &rest) != 2) return false;
+
+	return shard.count > 0 && shard.index >= 0 && shard.index < shard.count;
+}
+
+// in_edge_number counts the in edges in edge id order
+bool in_shard(MatchShard shard, int in_edge_number)
+{
+	return in_edge_number % shard.count == shard.index;
+}
+
+// Writes the lists as the candidate graph EdgeScores reads, each row
+// sorted and scores quantised against the worst kept score.
+void write_candidate_graph(string filename, CandidateLists& lists)
+{
+	double worst = 0;
+	for (int i = 0; i < lists.rows.size(); i++)
+	{
+		sort(lists.rows[i].begin(), lists.rows[i].end(), candidate_better);
+		if (lists.rows[i].size() > 0) worst = max(worst, lists.rows[i].back().score);
+	}
+
+	double scale = worst > 0 ? CANDIDATE_GRAPH_LEVELS / worst : 1;
+
+	fstream fs (filename.c_str(), fstream::out);
+
+	fs << CANDIDATE_GRAPH_MAGIC << " " << lists.names.size() << " " << lists.top_k << " " << scale << endl;
+
+	for (int p = 0; p < lists.names.size(); p++)
+	{
+		fs << lists.names[p];
+		for (int e = 0; e < EDGE_COUNT; e++) fs << " " << lists.types[EDGE_ID(p, e)];
+		fs << endl;
+	}
+
+	int offset = 0;
+	fs << offset;
+	for (int i = 0; i < lists.rows.size(); i++)
+	{
+		offset += lists.rows[i].size();
+		fs << " " << offset;
+	}
+	fs << endl;
+
+	for (int i = 0; i < lists.rows.size(); i++)
+	{
+		vector<EdgeCandidate>& row = lists.rows[i];
+
+		for (int c = 0; c < row.size(); c++)
+		{
+			fs << (c > 0 ? " " : "") << row[c].edge << " " << min(cvRound(row[c].score * scale), CANDIDATE_GRAPH_LEVELS);
+		}
+		fs << endl;
+	}
+
+	fs.close();
+}
+
+// A shard's candidates with their scores in full, so merging gives the
+// same graph as one process would have.
+//	PART piece_count k shard count
+//	name type type type type	(per piece)
+//	n edge score edge score ...	(per edge, n candidates)
+void write_partial_candidates(string filename, CandidateLists& lists, MatchShard shard)
+{
+	fstream fs (filename.c_str(), fstream::out);
+	fs.precision(17);
+
+	fs << PARTIAL_CANDIDATES_MAGIC << " " << lists.names.size() << " " << lists.top_k << " ";
+	fs << shard.index << " " << shard.count << endl;
+
+	for (int p = 0; p < lists.names.size(); p++)
+	{
+		fs << lists.names[p];
+		for (int e = 0; e < EDGE_COUNT; e++) fs << " " << lists.types[EDGE_ID(p, e)];
+		fs << endl;
+	}
+
+	for (int i = 0; i < lists.rows.size(); i++)
+	{
+		vector<EdgeCandidate>& row = lists.rows[i];
+
+		sort(row.begin(), row.end(), candidate_better);
+
+		fs << row.size();
+		for (int c = 0; c < row.size(); c++) fs << " " << row[c].edge << " " << row[c].score;
+		fs << endl;
+	}
+
+	fs.close();
+}
+
+void read_partial_candidates(string filename, CandidateLists& lists, MatchShard& shard)
+{
+	fstream fs (filename.c_str(), fstream::in);
+
+	string magic;
+	int piece_count;
+
+	if (!(fs >> magic) || magic != PARTIAL_CANDIDATES_MAGIC) throw runtime_error("Not a partial candidate file");
+	if (!(fs >> piece_count >> lists.top_k >> shard.index >> shard.count)) throw runtime_error("Failed to read header");
+
+	lists.names.resize(piece_count);
+	lists.types.resize(piece_count * EDGE_COUNT);
+	lists.rows.assign(piece_count * EDGE_COUNT, vector<EdgeCandidate>());
+
+	for (int p = 0; p < piece_count; p++)
+	{
+		fs >> lists.names[p];
+		for (int e = 0; e < EDGE_COUNT; e++) fs >> lists.types[EDGE_ID(p, e)];
+	}
+
+	for (int i = 0; i < lists.rows.size(); i++)
+	{
+		int count;
+		if (!(fs >> count)) throw runtime_error("Failed to read candidates");
+
+		lists.rows[i].resize(count);
+		for (int c = 0; c < count; c++)
+		{
+			fs >> lists.rows[i][c].edge >> lists.rows[i][c].score;
+		}
+	}
+
+	if (!fs) throw runtime_error("Failed to read candidates");
+}
+
+// Keeps the best top_k of both lists for every edge. Candidate order is
+// total so the result doesn't depend on the order lists are merged in.
+void merge_candidates(CandidateLists& into, CandidateLists& from)
+{
+	for (int i = 0; i < into.rows.size(); i++)
+	{
+		vector<EdgeCandidate>& row = into.rows[i];
+
+		make_heap(row.begin(), row.end(), candidate_better);
+
+		for (int c = 0; c < from.rows[i].size(); c++)
+		{
+			keep_candidate(row, from.rows[i][c], into.top_k);
+		}
+
+		sort(row.begin(), row.end(), candidate_better);
+	}
+}
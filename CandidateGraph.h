@@ -0,0 +1,41 @@
+#ifndef _CANDIDATE_GRAPH_
+#define _CANDIDATE_GRAPH_
+
+#include <vector>
+#include <string>
+
+#include "EdgeScores.h"
+
+// The first word of a shard's partial candidate file
+#define PARTIAL_CANDIDATES_MAGIC "PART"
+
+using namespace std;
+
+// Shard index of count. The in edges, in edge id order, are dealt out to
+// the shards in turn, so every in edge and all its pairs belong to
+// exactly one shard whatever the count.
+struct MatchShard
+{
+	int index;
+	int count;
+};
+
+// What a candidate file holds: the pieces, each edge's candidates and how
+// many were kept per edge. rows are indexed by edge id.
+struct CandidateLists
+{
+	vector<string> names;
+	vector<int> types;
+	vector<vector<EdgeCandidate> > rows;
+	int top_k;
+};
+
+bool parse_shard(string text, MatchShard& shard);
+bool in_shard(MatchShard shard, int in_edge_number);
+
+void write_candidate_graph(string filename, CandidateLists& lists);
+void write_partial_candidates(string filename, CandidateLists& lists, MatchShard shard);
+void read_partial_candidates(string filename, CandidateLists& lists, MatchShard& shard);
+void merge_candidates(CandidateLists& into, CandidateLists& from);
+
+#endif
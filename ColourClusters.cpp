@@ -0,0 +1,123 @@
+#include "ColourClusters.h"
+
+#include "opencv2/imgproc/imgproc.hpp"
+
+#include <cmath>
+
+// A hue / saturation histogram of the piece, counting only pixels inside
+// its outline. Bins are square rooted so the straight line distance
+// between two descriptors behaves like the Hellinger distance between the
+// histograms.
+void colour_descriptor(PieceData& piece, vector<float>& out)
+{
+	Mat image = piece.image();
+	Mat hsv;
+	cvtColor(image, hsv, CV_BGR2HSV);
+
+	vector<vector<Point> > outline (1, piece.edge());
+	for (int i = 0; i < outline[0].size(); i++) outline[0][i] += piece.origin();
+
+	Mat mask = Mat::zeros(image.size(), CV_8UC1);
+	fillPoly(mask, outline, Scalar(255));
+
+	int channels[] = { 0, 1 };
+	int bins[] = { DESCRIPTOR_HUE_BINS, DESCRIPTOR_SAT_BINS };
+	float hue_range[] = { 0, 180 };
+	float sat_range[] = { 0, 256 };
+	const float* ranges[] = { hue_range, sat_range };
+
+	Mat hist;
+	calcHist(&hsv, 1, channels, mask, hist, 2, bins, ranges);
+
+	double total = max(sum(hist)[0], 1.0);
+
+	out.resize(DESCRIPTOR_HUE_BINS * DESCRIPTOR_SAT_BINS);
+	for (int h = 0; h < DESCRIPTOR_HUE_BINS; h++)
+	{
+		for (int s = 0; s < DESCRIPTOR_SAT_BINS; s++)
+		{
+			out[h * DESCRIPTOR_SAT_BINS + s] = (float)sqrt(hist.at<float>(h, s) / total);
+		}
+	}
+}
+
+// Clusters the descriptors with k-means. Pieces near a boundary between
+// clusters join every cluster within CLUSTER_OVERLAP of their nearest, and
+// clusters that end up sharing pieces are adjacent.
+void cluster_pieces(vector<vector<float> >& descriptors, int cluster_count, ColourClusters& clusters)
+{
+	int piece_count = descriptors.size();
+	int k = min(min(cluster_count, piece_count), MAX_COLOUR_CLUSTERS);
+
+	clusters.count = k;
+	clusters.member.assign(piece_count, 0);
+	clusters.reach.assign(piece_count, 0);
+
+	if (k <= 0) return;
+
+	int dims = descriptors[0].size();
+	Mat samples (piece_count, dims, CV_32F);
+
+	for (int p = 0; p < piece_count; p++)
+	{
+		for (int d = 0; d < dims; d++) samples.at<float>(p, d) = descriptors[p][d];
+	}
+
+	Mat labels;
+	Mat centres;
+	kmeans(samples, k, labels, TermCriteria(CV_TERMCRIT_ITER | CV_TERMCRIT_EPS, KMEANS_ITERATIONS, 1e-4),
+		KMEANS_ATTEMPTS, KMEANS_PP_CENTERS, centres);
+
+	vector<vector<int> > shared (k, vector<int>(k, 0));
+
+	for (int p = 0; p < piece_count; p++)
+	{
+		vector<double> distances (k);
+		double nearest = HUGE_VAL;
+
+		for (int c = 0; c < k; c++)
+		{
+			distances[c] = norm(samples.row(p), centres.row(c));
+			nearest = min(nearest, distances[c]);
+		}
+
+		for (int c = 0; c < k; c++)
+		{
+			if (distances[c] <= nearest * (1 + CLUSTER_OVERLAP)) clusters.member[p] |= (uint64_t)1 << c;
+		}
+
+		for (int a = 0; a < k; a++)
+		{
+			for (int b = 0; b < k; b++)
+			{
+				if ((clusters.member[p] >> a & 1) && (clusters.member[p] >> b & 1)) shared[a][b]++;
+			}
+		}
+	}
+
+	vector<uint64_t> adjacent (k, 0);
+	for (int a = 0; a < k; a++)
+	{
+		for (int b = 0; b < k; b++)
+		{
+			if (a == b || shared[a][b] >= CLUSTER_ADJACENT_PIECES) adjacent[a] |= (uint64_t)1 << b;
+		}
+	}
+
+	for (int p = 0; p < piece_count; p++)
+	{
+		for (int c = 0; c < k; c++)
+		{
+			if (clusters.member[p] >> c & 1) clusters.reach[p] |= adjacent[c];
+		}
+	}
+}
+
+// Whether the pieces share a cluster or sit in adjacent ones. Always true
+// when there are no clusters.
+bool may_match(ColourClusters& clusters, int pieceA, int pieceB)
+{
+	if (clusters.count == 0) return true;
+
+	return (clusters.reach[pieceA] & clusters.member[pieceB]) != 0;
+}
@@ -0,0 +1,45 @@
+#ifndef _COLOUR_CLUSTERS_
+#define _COLOUR_CLUSTERS_
+
+#include "opencv2/core/core.hpp"
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include "PieceData.h"
+
+// Hue and saturation bins of a piece's colour descriptor
+#define DESCRIPTOR_HUE_BINS 16
+#define DESCRIPTOR_SAT_BINS 4
+
+// Most clusters a run can have, one bit each
+#define MAX_COLOUR_CLUSTERS 64
+
+// A piece also joins any cluster whose centre is this much further away
+// than its nearest
+#define CLUSTER_OVERLAP 0.25
+
+// Clusters sharing at least this many pieces are adjacent
+#define CLUSTER_ADJACENT_PIECES 3
+
+#define KMEANS_ATTEMPTS 3
+#define KMEANS_ITERATIONS 50
+
+using namespace std;
+using namespace cv;
+
+// Which pieces may be matched against each other. member is each piece's
+// clusters, reach is its clusters and those adjacent to them, as bits.
+struct ColourClusters
+{
+	int count;
+	vector<uint64_t> member;
+	vector<uint64_t> reach;
+};
+
+void colour_descriptor(PieceData& piece, vector<float>& out);
+void cluster_pieces(vector<vector<float> >& descriptors, int cluster_count, ColourClusters& clusters);
+bool may_match(ColourClusters& clusters, int pieceA, int pieceB);
+
+#endif
@@ -0,0 +1,274 @@
+#include "CornerFinder.h"
+#include "GeometryHelpers.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// Slack given to the angle windows so rounding differences between atan2
+// and within_right_angle never drop a point. Every candidate is still
+// checked with within_right_angle so the slack can't add any.
+#define ANGLE_WINDOW_SLACK 1e-6
+
+// For every point m, the direction (in degrees) to every other point and
+// the other points sorted by that direction. Lets all the points which make
+// a given angle at m be found with a binary search.
+struct AngleTable
+{
+	vector<vector<double> > direction;
+	vector<vector<double> > sorted_directions;
+	vector<vector<int> > sorted_points;
+};
+
+void build_angle_table(vector<Point>& points, AngleTable& table)
+{
+	int n = points.size();
+
+	table.direction.assign(n, vector<double>(n, 0));
+	table.sorted_directions.assign(n, vector<double>());
+	table.sorted_points.assign(n, vector<int>());
+
+	for (int m = 0; m < n; m++)
+	{
+		vector<pair<double, int> > directions;
+
+		for (int p = 0; p < n; p++)
+		{
+			if (p == m) continue;
+
+			Point diff = points[p] - points[m];
+			double angle = TO_DEGREE(atan2((double)diff.y, (double)diff.x));
+			table.direction[m][p] = angle;
+			directions.push_back(make_pair(angle, p));
+		}
+
+		sort(directions.begin(), directions.end());
+
+		for (int i = 0; i < directions.size(); i++)
+		{
+			table.sorted_directions[m].push_back(directions[i].first);
+			table.sorted_points[m].push_back(directions[i].second);
+		}
+	}
+}
+
+// Appends every point whose direction from m lies in [low, high] degrees,
+// wrapping around at +-180.
+void angle_window(AngleTable& table, int m, double low, double high, vector<int>& out)
+{
+	vector<double>& directions = table.sorted_directions[m];
+	vector<int>& points = table.sorted_points[m];
+	int count = directions.size();
+
+	while (low < -180) { low += 360; high += 360; }
+	while (low >= 180) { low -= 360; high -= 360; }
+
+	int start = lower_bound(directions.begin(), directions.end(), low) - directions.begin();
+
+	for (int step = 0; step < count; step++)
+	{
+		int index = start + step;
+		double angle = (index < count) ? directions[index] : directions[index - count] + 360;
+
+		if (angle > high) break;
+
+		out.push_back(points[index % count]);
+	}
+}
+
+// Every point q which could make a right angle p-m-q, to within
+// right_angle_diff degrees.
+void right_angle_candidates(AngleTable& table, int m, int p, double right_angle_diff, vector<int>& out)
+{
+	out.clear();
+
+	double base = table.direction[m][p];
+	double angle_min = 90 - right_angle_diff - ANGLE_WINDOW_SLACK;
+	double angle_max = 90 + right_angle_diff + ANGLE_WINDOW_SLACK;
+
+	angle_window(table, m, base + angle_min, base + angle_max, out);
+	angle_window(table, m, base - angle_max, base - angle_min, out);
+}
+
+bool corner_order_before(int a[4], int b[4])
+{
+	for (int i = 0; i < 4; i++)
+	{
+		if (a[i] != b[i]) return a[i] < b[i];
+	}
+
+	return false;
+}
+
+// Finds the same corners as find_corner_points_exhaustive without trying
+// every set of four points. The near right angle tests against the
+// estimated origin are worked out once per pair up front. Then rather
+// than looping over all k and l, only the points inside the angle windows
+// which can make a right angle at i (for k) and at k (for l) are visited,
+// found by binary search in the angle table. Candidates go through exactly
+// the same tests as the exhaustive search, ties on area go to the set of
+// points it would have found first. Assumes no two points are the same,
+// which approxPolyDP guarantees.
+vector<Point> find_corner_points(vector<Point>& smoothed_edge, Size area_size, double right_angle_diff)
+{
+	int n = smoothed_edge.size();
+	double greatest_area = 0;
+	int best[4] = { 0, 0, 0, 0 };
+	vector<Point> corner_points (4);
+
+	// Tolerances for within_right_angle, worked out once per piece
+	double right_tolerance = right_angle_tolerance(right_angle_diff);
+	double nearly_right_tolerance = right_angle_tolerance(right_angle_diff * NEARLY_RIGHT_ANGLE_FACTOR);
+
+	Point estimated_origin (area_size.width / 2, area_size.height / 2);
+
+	// Near right angle at the origin, for every pair of points
+	vector<vector<char> > nearly_right (n, vector<char>(n, 0));
+	for (int a = 0; a < n; a++)
+	{
+		for (int b = 0; b < n; b++)
+		{
+			if (a == b) continue;
+
+			nearly_right[a][b] = within_right_angle(estimated_origin, smoothed_edge[a], smoothed_edge[b], nearly_right_tolerance);
+		}
+	}
+
+	AngleTable table;
+	build_angle_table(smoothed_edge, table);
+
+	vector<int> k_candidates;
+	vector<int> l_candidates;
+
+	for (int i = 0; i < n; i++) 
+	{
+		for (int j = 0; j < n; j++) 
+		{
+			if (j == i || !nearly_right[i][j]) continue;
+
+			right_angle_candidates(table, i, j, right_angle_diff, k_candidates);
+
+			for (int ki = 0; ki < k_candidates.size(); ki++) 
+			{
+				int k = k_candidates[ki];
+				if (k == j || !nearly_right[i][k]) continue;
+
+				if (!within_right_angle(smoothed_edge[i], smoothed_edge[j], smoothed_edge[k], right_tolerance)) continue;
+
+				right_angle_candidates(table, k, i, right_angle_diff, l_candidates);
+
+				for (int li = 0; li < l_candidates.size(); li++) 
+				{
+					int l = l_candidates[li];
+					if (l == j || l == i || !nearly_right[k][l] || !nearly_right[j][l]) continue;
+
+					if (!within_right_angle(smoothed_edge[k], smoothed_edge[i], smoothed_edge[l], right_tolerance)) continue;
+					
+					if (!within_right_angle(smoothed_edge[l], smoothed_edge[k], smoothed_edge[j], right_tolerance)) continue;
+
+					double area = area_of_rectangle(smoothed_edge[l], smoothed_edge[k], smoothed_edge[j]);
+					int found[4] = { i, j, k, l };
+
+					if (area > greatest_area || (area == greatest_area && area > 0 && corner_order_before(found, best)))
+					{
+						greatest_area = area;
+						copy(found, found + 4, best);
+					}
+				}
+			}
+		}
+	}
+
+	if (greatest_area == 0)
+	{
+		corner_points.clear();
+		return corner_points;
+	}
+
+	for (int c = 0; c < 4; c++)
+	{
+		corner_points[c] = smoothed_edge[best[c]];
+	}
+
+	return corner_points;
+}
+
+// Attempts to find the corner points of the piece contour by finding the four points
+// which create the (roughly) rectanglaur quadralateral with the largest area.
+// Tries every ordered set of four points so is O(n^4), kept as the reference
+// find_corner_points is checked against.
+vector<Point> find_corner_points_exhaustive(vector<Point>& smoothed_edge, Size area_size, double right_angle_diff)
+{
+	double greatest_area = 0;
+	vector<Point> corner_points (4);
+
+	double right_tolerance = right_angle_tolerance(right_angle_diff);
+	double nearly_right_tolerance = right_angle_tolerance(right_angle_diff * NEARLY_RIGHT_ANGLE_FACTOR);
+
+	Point estimated_origin (area_size.width / 2, area_size.height / 2);
+
+	for (int i = 0; i < smoothed_edge.size(); i++) 
+	{
+		for (int j = 0; j < smoothed_edge.size(); j++) 
+		{
+			if (j == i) continue;
+
+			if (!within_right_angle(estimated_origin, smoothed_edge[i], smoothed_edge[j], nearly_right_tolerance)) continue;
+
+			for (int k = 0; k < smoothed_edge.size(); k++) 
+			{
+				if (k == j || k == i) continue;
+				
+				if (!within_right_angle(smoothed_edge[i], smoothed_edge[j], smoothed_edge[k], right_tolerance)) continue;
+
+				if (!within_right_angle(estimated_origin, smoothed_edge[i], smoothed_edge[k], nearly_right_tolerance)) continue;
+
+				for (int l = 0; l < smoothed_edge.size(); l++) 
+				{
+					if (l == k || l == j || l == i) continue;
+
+					if (!within_right_angle(smoothed_edge[k], smoothed_edge[i], smoothed_edge[l], right_tolerance)) continue;
+					
+					if (!within_right_angle(smoothed_edge[l], smoothed_edge[k], smoothed_edge[j], right_tolerance)) continue;
+
+					if (!within_right_angle(estimated_origin, smoothed_edge[k], smoothed_edge[l], nearly_right_tolerance)) continue;
+
+					if (!within_right_angle(estimated_origin, smoothed_edge[j], smoothed_edge[l], nearly_right_tolerance)) continue;
+					
+					double area = area_of_rectangle(smoothed_edge[l], smoothed_edge[k], smoothed_edge[j]);
+					//TODO: use area of intersection
+					if (area > greatest_area) 
+					{
+						greatest_area = area;
+						corner_points[0] = smoothed_edge[i];
+						corner_points[1] = smoothed_edge[j];
+						corner_points[2] = smoothed_edge[k];
+						corner_points[3] = smoothed_edge[l];
+
+					}
+				}
+			}
+		}
+	}
+
+	if (greatest_area == 0)
+	{
+		corner_points.clear();
+	}
+
+	/*
+	cout << corner_points[0] << corner_points[1] << corner_points[2] << corner_points[3] << endl;
+
+	double angle;
+	angle = interior_angle_d(estimated_origin, corner_points[0], corner_points[1]);
+	cout << "i-j " << angle << endl;
+	angle = interior_angle_d(estimated_origin, corner_points[0], corner_points[2]);
+	cout << "i-k " << angle << endl;
+	angle = interior_angle_d(estimated_origin, corner_points[2], corner_points[3]);
+	cout << "k-l " << angle << endl;
+	angle = interior_angle_d(estimated_origin, corner_points[1], corner_points[3]);
+	cout << "j-l " << angle << endl;
+	*/
+
+	return corner_points;
+}
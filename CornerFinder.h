@@ -0,0 +1,17 @@
+#ifndef _CORNER_FINDER_
+#define _CORNER_FINDER_
+
+#include "opencv2/imgproc/imgproc.hpp"
+
+#include <vector>
+
+#define RIGHT_ANGLE_DIFF 7.0
+#define NEARLY_RIGHT_ANGLE_FACTOR 3.5
+
+using namespace std;
+using namespace cv;
+
+vector<Point> find_corner_points(vector<Point>& smoothed_edge, Size area_size, double right_angle_diff = RIGHT_ANGLE_DIFF);
+vector<Point> find_corner_points_exhaustive(vector<Point>& smoothed_edge, Size area_size, double right_angle_diff = RIGHT_ANGLE_DIFF);
+
+#endif
@@ -0,0 +1,114 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#include "PieceData.h"
+#include "PieceHash.h"
+
+#define DEFAULT_KEPT_FILE "kept.txt"
+
+using namespace std;
+
+//--- Forward declarations
+int dedup(vector<string>& filenames, string kept_filename);
+//---
+
+// argv should contain the pieces written by the Segmenter. Pieces
+// photographed more than once are found by their signatures (see
+// PieceHash) and only the sharpest of each is kept, so later stages
+// don't classify, match and place the same piece twice.
+// '-o <file>' names the list of kept pieces, a line each.
+int main(int argc, char* argv[])
+{
+	string kept_filename = DEFAULT_KEPT_FILE;
+	vector<string> filenames;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+		{
+			kept_filename = string(argv[++i]);
+			continue;
+		}
+
+		filenames.push_back(string(argv[i]));
+	}
+
+	if (filenames.size() == 0)
+	{
+		cout << "Usage: Dedup [-o kept] piece..." << endl;
+		return EXIT_FAILURE;
+	}
+
+	return dedup(filenames, kept_filename);
+}
+
+int dedup(vector<string>& filenames, string kept_filename)
+{
+	int64 start = getTickCount();
+
+	vector<PieceSignature> signatures (filenames.size());
+
+	for (int i = 0; i < filenames.size(); i++)
+	{
+		try
+		{
+			PieceData pd (filenames[i]);
+			piece_signature(pd, signatures[i]);
+		}
+		catch (runtime_error& e)
+		{
+			cout << "Error on piece '" << filenames[i] << "'. " << e.what() << "." << endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	vector<int> group;
+	group_duplicates(signatures, group);
+
+	vector<vector<int> > members (filenames.size());
+	for (int i = 0; i < filenames.size(); i++) members[group[i]].push_back(i);
+
+	fstream fs (kept_filename.c_str(), fstream::out);
+	int group_count = 0;
+	int duplicate_count = 0;
+
+	for (int g = 0; g < members.size(); g++)
+	{
+		if (members[g].size() == 0) continue;
+
+		// The sharpest photo of each piece stands for it
+		int kept = members[g][0];
+		for (int m = 1; m < members[g].size(); m++)
+		{
+			if (signatures[members[g][m]].sharpness > signatures[kept].sharpness) kept = members[g][m];
+		}
+
+		fs << filenames[kept] << endl;
+
+		if (members[g].size() == 1) continue;
+
+		cout << "Kept '" << filenames[kept] << "' over";
+		for (int m = 0; m < members[g].size(); m++)
+		{
+			if (members[g][m] != kept) cout << " '" << filenames[members[g][m]] << "'";
+		}
+		cout << endl;
+
+		group_count++;
+		duplicate_count += members[g].size() - 1;
+	}
+
+	fs.close();
+
+	double seconds = (getTickCount() - start) / getTickFrequency();
+
+	cout << "Found " << duplicate_count << " duplicates of " << group_count << " pieces among " << filenames.size() << " in " << seconds << "s" << endl;
+	cout << "Kept pieces written to '" << kept_filename << "'" << endl;
+
+	return EXIT_SUCCESS;
+}
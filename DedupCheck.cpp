@@ -0,0 +1,172 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+
+#include "PieceHash.h"
+
+#define DEFAULT_CHECK_COUNT 20000
+
+// Share of the synthetic pieces that are another piece photographed again
+#define CHECK_DUPLICATE_SHARE 0.25
+
+// How far a photo taken again moves each feature, shape and the area
+#define CHECK_FEATURE_NOISE 4.0
+#define CHECK_SHAPE_NOISE 0.05
+#define CHECK_AREA_NOISE 0.03
+
+using namespace std;
+
+//--- Forward declarations
+void synthetic_features(RNG& rng, double features[HASH_RING_FEATURES][HASH_RINGS]);
+void brute_force_groups(vector<PieceSignature>& signatures, vector<int>& group);
+//---
+
+// Checks group_duplicates against comparing every pair, on synthetic
+// signatures rather than photos so it runs anywhere. A share of them are
+// noisy copies of earlier ones, some near enough to be duplicates and
+// some not, and some have rings that tie. The two groupings must match.
+// '-n <count>' sets the number of signatures, '-s <seed>' the seed.
+int main(int argc, char* argv[])
+{
+	int count = DEFAULT_CHECK_COUNT;
+	int seed = 1;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+		{
+			count = max(atoi(argv[++i]), 1);
+			continue;
+		}
+
+		if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+		{
+			seed = atoi(argv[++i]);
+			continue;
+		}
+
+		cout << "Usage: DedupCheck [-n count] [-s seed]" << endl;
+		return EXIT_FAILURE;
+	}
+
+	RNG rng (seed);
+	vector<PieceSignature> signatures (count);
+	vector<vector<double> > kept_features (count);
+	double features[HASH_RING_FEATURES][HASH_RINGS];
+
+	for (int i = 0; i < count; i++)
+	{
+		PieceSignature& signature = signatures[i];
+
+		if (i > 0 && rng.uniform(0.0, 1.0) < CHECK_DUPLICATE_SHARE)
+		{
+			int original = rng.uniform(0, i);
+
+			signature = signatures[original];
+			signature.area *= 1 + rng.uniform(-CHECK_AREA_NOISE, CHECK_AREA_NOISE);
+			for (int s = 0; s < 7; s++) signature.shape[s] += rng.uniform(-CHECK_SHAPE_NOISE, CHECK_SHAPE_NOISE);
+
+			for (int f = 0; f < HASH_RING_FEATURES; f++)
+			{
+				for (int r = 0; r < HASH_RINGS; r++)
+				{
+					features[f][r] = kept_features[original][f * HASH_RINGS + r] + rng.uniform(-CHECK_FEATURE_NOISE, CHECK_FEATURE_NOISE);
+				}
+			}
+		}
+		else
+		{
+			signature.area = rng.uniform(1000.0, 2000.0);
+			for (int s = 0; s < 7; s++) signature.shape[s] = rng.uniform(0.0, 10.0);
+
+			synthetic_features(rng, features);
+		}
+
+		signature.hash = feature_hash(features);
+		signature.sharpness = 0;
+		kept_features[i].assign(&features[0][0], &features[0][0] + HASH_RING_FEATURES * HASH_RINGS);
+	}
+
+	int64 start = getTickCount();
+
+	vector<int> group;
+	group_duplicates(signatures, group);
+
+	double indexed_seconds = (getTickCount() - start) / getTickFrequency();
+	start = getTickCount();
+
+	vector<int> expected;
+	brute_force_groups(signatures, expected);
+
+	double brute_seconds = (getTickCount() - start) / getTickFrequency();
+
+	int group_count = 0;
+	int wrong = 0;
+
+	for (int i = 0; i < count; i++)
+	{
+		if (expected[i] == i) group_count++;
+		if (group[i] != expected[i]) wrong++;
+	}
+
+	cout << count << " signatures in " << group_count << " groups, indexed in " << indexed_seconds << "s, ";
+	cout << "every pair in " << brute_seconds << "s" << endl;
+
+	if (wrong > 0)
+	{
+		cout << "Error on grouping. " << wrong << " signatures grouped differently from comparing every pair." << endl;
+		return EXIT_FAILURE;
+	}
+
+	cout << "Groups match comparing every pair" << endl;
+
+	return EXIT_SUCCESS;
+}
+
+// Random ring features, with a few rings sometimes made equal as a plain
+// ring would be
+void synthetic_features(RNG& rng, double features[HASH_RING_FEATURES][HASH_RINGS])
+{
+	for (int f = 0; f < HASH_RING_FEATURES; f++)
+	{
+		double plain = rng.uniform(0.0, 100.0);
+		bool ties = rng.uniform(0, 4) == 0;
+
+		for (int r = 0; r < HASH_RINGS; r++)
+		{
+			features[f][r] = (ties && rng.uniform(0, 2) == 0) ? plain : rng.uniform(0.0, 100.0);
+		}
+	}
+}
+
+// The same grouping as group_duplicates, lowest numbered piece of each
+// group, from testing every pair
+void brute_force_groups(vector<PieceSignature>& signatures, vector<int>& group)
+{
+	group.resize(signatures.size());
+	for (int i = 0; i < group.size(); i++) group[i] = i;
+
+	for (int i = 0; i < signatures.size(); i++)
+	{
+		for (int j = 0; j < i; j++)
+		{
+			if (!near_duplicate(signatures[i], signatures[j])) continue;
+
+			int group_i = i;
+			int group_j = j;
+			while (group[group_i] != group_i) group_i = group[group_i];
+			while (group[group_j] != group_j) group_j = group[group_j];
+
+			group[max(group_i, group_j)] = min(group_i, group_j);
+		}
+	}
+
+	for (int i = 0; i < group.size(); i++)
+	{
+		int root = i;
+		while (group[root] != root) root = group[root];
+		group[i] = root;
+	}
+}
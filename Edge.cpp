@@ -26,6 +26,11 @@ ptIter Edge::end()
 	return pd.getEdgeEnd(edge_index);
 }
 
+void Edge::canonicalPoints(vector<Point>& out)
+{
+	pd.canonicalEdge(edge_index, out);
+}
+
 int Edge::index()
 {
 	return edge_index;
@@ -17,6 +17,7 @@ class Edge
 		Point getSecondCorner();
 		ptIter begin();
 		ptIter end();
+		void canonicalPoints(vector<Point>& out);
 		int index();
 		int type();
 		PieceData* piece();
@@ -0,0 +1,129 @@
+#include "EdgeAlignment.h"
+
+#include <cmath>
+
+#include "GeometryHelpers.h"
+
+// The in edge drawn into a small image with ALIGN_FIELD_MARGIN round it
+// and the distance to it taken once, so scoring a pose is a lookup per
+// point rather than a search of the in edge.
+void build_edge_field(vector<Point>& curve, EdgeField& field)
+{
+	Rect bounds = contour_bounding_rect(curve);
+
+	field.corner = Point(bounds.x - ALIGN_FIELD_MARGIN, bounds.y - ALIGN_FIELD_MARGIN);
+	field.pivot = Point2d(curve.back().x / 2.0, 0);
+
+	Mat drawn (bounds.height + 2 * ALIGN_FIELD_MARGIN + 1, bounds.width + 2 * ALIGN_FIELD_MARGIN + 1, CV_8UC1, Scalar(255));
+
+	for (int i = 1; i < curve.size(); i++)
+	{
+		line(drawn, curve[i - 1] - field.corner, curve[i] - field.corner, Scalar(0), 1);
+	}
+
+	distanceTransform(drawn, field.distance, CV_DIST_L2, CV_DIST_MASK_PRECISE);
+}
+
+// Points off the field count as the distance at its nearest border
+float field_distance(EdgeField& field, float x, float y)
+{
+	int col = min(max(cvRound(x) - field.corner.x, 0), field.distance.cols - 1);
+	int row = min(max(cvRound(y) - field.corner.y, 0), field.distance.rows - 1);
+
+	return field.distance.ptr<float>(row)[col];
+}
+
+// Every pose in the grid is scored in one pass over the points, a batch of
+// ALIGN_BATCH_POINTS at a time. The stored alignment is scored in full
+// first, and after each batch the poses whose distance so far is already
+// no better are dropped, as the rest of the points can only add to it.
+// The pose with the lowest mean distance wins, ties going to the stored
+// alignment.
+EdgePose refine_edge_pose(EdgeField& field, vector<Point>& curve)
+{
+	int point_count = curve.size();
+
+	vector<float> cos_a;
+	vector<float> sin_a;
+	vector<float> shift_x;
+	vector<float> shift_y;
+	vector<EdgePose> poses;
+
+	for (int r = -ALIGN_ROTATION_STEPS; r <= ALIGN_ROTATION_STEPS; r++)
+	{
+		for (int dy = -ALIGN_OFFSET_STEPS; dy <= ALIGN_OFFSET_STEPS; dy++)
+		{
+			for (int dx = -ALIGN_OFFSET_STEPS; dx <= ALIGN_OFFSET_STEPS; dx++)
+			{
+				if (r == 0 && dy == 0 && dx == 0) continue;
+
+				EdgePose pose = { TO_RAD(r * ALIGN_ROTATION_STEP), Point2d(dx * ALIGN_OFFSET_STEP, dy * ALIGN_OFFSET_STEP), 0 };
+				double c = cos(pose.angle);
+				double s = sin(pose.angle);
+
+				// Turning about the pivot folded into the shift
+				cos_a.push_back(c);
+				sin_a.push_back(s);
+				shift_x.push_back(field.pivot.x + pose.offset.x - c * field.pivot.x + s * field.pivot.y);
+				shift_y.push_back(field.pivot.y + pose.offset.y - s * field.pivot.x - c * field.pivot.y);
+				poses.push_back(pose);
+			}
+		}
+	}
+
+	EdgePose best = { 0, Point2d(0, 0), 0 };
+	for (int i = 0; i < point_count; i++) best.score += field_distance(field, curve[i].x, curve[i].y);
+
+	vector<int> active (poses.size());
+	for (int k = 0; k < active.size(); k++) active[k] = k;
+
+	for (int begin = 0; begin < point_count && active.size() > 0; begin += ALIGN_BATCH_POINTS)
+	{
+		int end = min(begin + ALIGN_BATCH_POINTS, point_count);
+		int kept = 0;
+
+		for (int a = 0; a < active.size(); a++)
+		{
+			int k = active[a];
+			double total = poses[k].score;
+
+			for (int i = begin; i < end; i++)
+			{
+				float x = cos_a[k] * curve[i].x - sin_a[k] * curve[i].y + shift_x[k];
+				float y = sin_a[k] * curve[i].x + cos_a[k] * curve[i].y + shift_y[k];
+				total += field_distance(field, x, y);
+			}
+
+			poses[k].score = total;
+			if (total < best.score) active[kept++] = k;
+		}
+
+		active.resize(kept);
+	}
+
+	// Whatever is left was scored over every point
+	for (int a = 0; a < active.size(); a++)
+	{
+		if (poses[active[a]].score < best.score) best = poses[active[a]];
+	}
+
+	best.score /= max(point_count, 1);
+
+	return best;
+}
+
+void apply_edge_pose(EdgeField& field, EdgePose pose, vector<Point>& curve, vector<Point>& out)
+{
+	double c = cos(pose.angle);
+	double s = sin(pose.angle);
+
+	out.resize(curve.size());
+
+	for (int i = 0; i < curve.size(); i++)
+	{
+		double x = curve[i].x - field.pivot.x;
+		double y = curve[i].y - field.pivot.y;
+
+		out[i] = Point(cvRound(c * x - s * y + field.pivot.x + pose.offset.x), cvRound(s * x + c * y + field.pivot.y + pose.offset.y));
+	}
+}
@@ -0,0 +1,49 @@
+#ifndef _EDGE_ALIGNMENT_
+#define _EDGE_ALIGNMENT_
+
+#include "opencv2/imgproc/imgproc.hpp"
+
+#include <vector>
+
+// The poses tried about the stored alignment: turns of up to
+// ALIGN_ROTATION_STEPS * ALIGN_ROTATION_STEP degrees each way and shifts
+// of up to ALIGN_OFFSET_STEPS * ALIGN_OFFSET_STEP pixels along and across
+#define ALIGN_ROTATION_STEPS 2
+#define ALIGN_ROTATION_STEP 1.0
+#define ALIGN_OFFSET_STEPS 2
+#define ALIGN_OFFSET_STEP 1.0
+
+// Pixels of distance field kept around an in edge's points
+#define ALIGN_FIELD_MARGIN 8
+
+// Points scored for every pose still in the running before the poses
+// already worse than the best are dropped
+#define ALIGN_BATCH_POINTS 16
+
+using namespace std;
+using namespace cv;
+
+// Distance from each pixel around an in edge (in the edge's frame) to the
+// edge, corner being where the field's top left is in that frame. Poses
+// turn about pivot, the middle of the edge.
+struct EdgeField
+{
+	Mat distance;
+	Point corner;
+	Point2d pivot;
+};
+
+// A turn (radians) about the field's pivot then a shift, and the mean
+// distance of the posed points from the in edge
+struct EdgePose
+{
+	double angle;
+	Point2d offset;
+	double score;
+};
+
+void build_edge_field(vector<Point>& curve, EdgeField& field);
+EdgePose refine_edge_pose(EdgeField& field, vector<Point>& curve);
+void apply_edge_pose(EdgeField& field, EdgePose pose, vector<Point>& curve, vector<Point>& out);
+
+#endif
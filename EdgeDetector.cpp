@@ -0,0 +1,277 @@
+#include "EdgeDetector.h"
+
+#include <cstdlib>
+
+#define TAN_22_5 0.41421356
+#define TAN_67_5 2.41421356
+
+#define DIRECTION_HORIZONTAL 0
+#define DIRECTION_DIAGONAL_DOWN 1
+#define DIRECTION_VERTICAL 2
+#define DIRECTION_DIAGONAL_UP 3
+
+#define CANDIDATE_NONE 0
+#define CANDIDATE_WEAK 1
+#define CANDIDATE_STRONG 255
+
+// A 3x3 box blur followed by a 3x3 sobel is the same as a single 5x5
+// separable filter, so the blur never has to be written out. Results
+// come out 9 times too big which is folded into the thresholds.
+const int SMOOTH_KERNEL[5] = { 1, 3, 4, 3, 1 };
+const int DERIV_KERNEL[5] = { -1, -1, 0, 1, 1 };
+
+uchar quantise_direction(int gx, int gy)
+{
+	double ax = abs(gx);
+	double ay = abs(gy);
+
+	if (ay <= ax * TAN_22_5) return DIRECTION_HORIZONTAL;
+	if (ay >= ax * TAN_67_5) return DIRECTION_VERTICAL;
+
+	// Same sign means the gradient points down and right (y is down)
+	return ((gx ^ gy) >= 0) ? DIRECTION_DIAGONAL_DOWN : DIRECTION_DIAGONAL_UP;
+}
+
+// Works out the gradient of every channel for a band of rows, straight
+// from the interleaved image, and keeps the strongest one. Responses are
+// scaled by each channel's low threshold so 1.0 is the low threshold
+// whichever channel won.
+class GradientBand : public ParallelLoopBody
+{
+	private:
+		const Mat& m_src;
+		Mat& m_response;
+		Mat& m_direction;
+		float m_scale[3];
+
+	public:
+		GradientBand(const Mat& src, Mat& response, Mat& direction, const int thresholds[3]) : m_src(src), m_response(response), m_direction(direction)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				m_scale[c] = 1.0f / (9.0f * thresholds[c]);
+			}
+		}
+
+		void operator()(const Range& range) const
+		{
+			int rows = m_src.rows;
+			int cols = m_src.cols;
+
+			// Vertical filter results, padded by two pixels either side
+			vector<int> smoothed ((cols + 4) * 3);
+			vector<int> derived ((cols + 4) * 3);
+
+			for (int y = range.start; y < range.end; y++)
+			{
+				const uchar* src_rows[5];
+				for (int k = 0; k < 5; k++)
+				{
+					int sy = min(max(y + k - 2, 0), rows - 1);
+					src_rows[k] = m_src.ptr<uchar>(sy);
+				}
+
+				for (int i = 0; i < cols * 3; i++)
+				{
+					int s = 0;
+					int d = 0;
+
+					for (int k = 0; k < 5; k++)
+					{
+						int value = src_rows[k][i];
+						s += SMOOTH_KERNEL[k] * value;
+						d += DERIV_KERNEL[k] * value;
+					}
+
+					smoothed[i + 6] = s;
+					derived[i + 6] = d;
+				}
+
+				// Replicate the border columns into the padding
+				for (int c = 0; c < 3; c++)
+				{
+					int first = 6 + c;
+					int last = 6 + (cols - 1) * 3 + c;
+
+					smoothed[c] = smoothed[c + 3] = smoothed[first];
+					derived[c] = derived[c + 3] = derived[first];
+					smoothed[last + 3] = smoothed[last + 6] = smoothed[last];
+					derived[last + 3] = derived[last + 6] = derived[last];
+				}
+
+				float* response = m_response.ptr<float>(y);
+				uchar* direction = m_direction.ptr<uchar>(y);
+
+				for (int x = 0; x < cols; x++)
+				{
+					float best = 0;
+					int best_gx = 0;
+					int best_gy = 0;
+
+					for (int c = 0; c < 3; c++)
+					{
+						const int* s = &smoothed[x * 3 + c];
+						const int* d = &derived[x * 3 + c];
+
+						int gx = 0;
+						int gy = 0;
+
+						for (int j = 0; j < 5; j++)
+						{
+							gx += DERIV_KERNEL[j] * s[j * 3];
+							gy += SMOOTH_KERNEL[j] * d[j * 3];
+						}
+
+						float r = (abs(gx) + abs(gy)) * m_scale[c];
+
+						if (r > best)
+						{
+							best = r;
+							best_gx = gx;
+							best_gy = gy;
+						}
+					}
+
+					response[x] = best;
+					direction[x] = quantise_direction(best_gx, best_gy);
+				}
+			}
+		}
+};
+
+// Non maximum suppression for a band of rows. Pixels which are a local
+// maximum across their gradient are marked weak or strong candidates.
+class SuppressBand : public ParallelLoopBody
+{
+	private:
+		const Mat& m_response;
+		const Mat& m_direction;
+		Mat& m_edges;
+		float m_high;
+
+	public:
+		SuppressBand(const Mat& response, const Mat& direction, Mat& edges, float high) : m_response(response), m_direction(direction), m_edges(edges)
+		{
+			m_high = high;
+		}
+
+		void operator()(const Range& range) const
+		{
+			int rows = m_response.rows;
+			int cols = m_response.cols;
+
+			for (int y = range.start; y < range.end; y++)
+			{
+				uchar* out = m_edges.ptr<uchar>(y);
+
+				if (y == 0 || y == rows - 1)
+				{
+					for (int x = 0; x < cols; x++) out[x] = CANDIDATE_NONE;
+					continue;
+				}
+
+				const float* prev = m_response.ptr<float>(y - 1);
+				const float* cur = m_response.ptr<float>(y);
+				const float* next = m_response.ptr<float>(y + 1);
+				const uchar* direction = m_direction.ptr<uchar>(y);
+
+				out[0] = CANDIDATE_NONE;
+				out[cols - 1] = CANDIDATE_NONE;
+
+				for (int x = 1; x < cols - 1; x++)
+				{
+					float m = cur[x];
+
+					if (m <= 1.0f)
+					{
+						out[x] = CANDIDATE_NONE;
+						continue;
+					}
+
+					float a, b;
+					switch (direction[x])
+					{
+						case DIRECTION_HORIZONTAL:    a = cur[x - 1];  b = cur[x + 1];  break;
+						case DIRECTION_VERTICAL:      a = prev[x];     b = next[x];     break;
+						case DIRECTION_DIAGONAL_DOWN: a = prev[x - 1]; b = next[x + 1]; break;
+						default:                      a = prev[x + 1]; b = next[x - 1]; break;
+					}
+
+					if (m > a && m >= b)
+					{
+						out[x] = (m > m_high) ? CANDIDATE_STRONG : CANDIDATE_WEAK;
+					}
+					else
+					{
+						out[x] = CANDIDATE_NONE;
+					}
+				}
+			}
+		}
+};
+
+// Grows the strong candidates along connected weak ones and drops
+// every weak candidate left unreached. The border is never a candidate
+// so neighbours of a candidate are always inside the image.
+void hysteresis(Mat& edges)
+{
+	vector<Point> stack;
+
+	for (int y = 0; y < edges.rows; y++)
+	{
+		uchar* row = edges.ptr<uchar>(y);
+		for (int x = 0; x < edges.cols; x++)
+		{
+			if (row[x] == CANDIDATE_STRONG) stack.push_back(Point(x, y));
+		}
+	}
+
+	while (!stack.empty())
+	{
+		Point p = stack.back();
+		stack.pop_back();
+
+		for (int dy = -1; dy <= 1; dy++)
+		{
+			uchar* row = edges.ptr<uchar>(p.y + dy);
+			for (int dx = -1; dx <= 1; dx++)
+			{
+				if (row[p.x + dx] == CANDIDATE_WEAK)
+				{
+					row[p.x + dx] = CANDIDATE_STRONG;
+					stack.push_back(Point(p.x + dx, p.y + dy));
+				}
+			}
+		}
+	}
+
+	for (int y = 0; y < edges.rows; y++)
+	{
+		uchar* row = edges.ptr<uchar>(y);
+		for (int x = 0; x < edges.cols; x++)
+		{
+			if (row[x] == CANDIDATE_WEAK) row[x] = CANDIDATE_NONE;
+		}
+	}
+}
+
+// Canny over all three channels of a BGR image at once, equivalent to
+// a 3x3 blur and canny (aperture 3) per channel with the results or-ed
+// together. Rather than eight passes over full size planes the image is
+// read once, in parallel row bands, keeping only the strongest channel's
+// gradient. thresholds are the per channel (B, G, R) low thresholds and
+// the high threshold is ratio times the low one. response and direction
+// are scratch buffers the caller can reuse between images.
+void fused_canny(Mat& src, Mat& edges, const int thresholds[3], double ratio, Mat& response, Mat& direction)
+{
+	CV_Assert(src.type() == CV_8UC3);
+
+	response.create(src.size(), CV_32FC1);
+	direction.create(src.size(), CV_8UC1);
+	edges.create(src.size(), CV_8UC1);
+
+	parallel_for_(Range(0, src.rows), GradientBand(src, response, direction, thresholds));
+	parallel_for_(Range(0, src.rows), SuppressBand(response, direction, edges, (float)ratio));
+
+	hysteresis(edges);
+}
@@ -0,0 +1,11 @@
+#ifndef _EDGE_DETECTOR_
+#define _EDGE_DETECTOR_
+
+#include "opencv2/imgproc/imgproc.hpp"
+
+using namespace std;
+using namespace cv;
+
+void fused_canny(Mat& src, Mat& edges, const int thresholds[3], double ratio, Mat& response, Mat& direction);
+
+#endif
@@ -7,337 +7,68 @@
 #include <fstream>
 #include <sstream>
 #include <cstdlib>
+#include <cstring>
 #include <cmath>
 #include <list>
+#include <map>
 
 #include "PieceData.h"
 #include "Edge.h"
 #include "GeometryHelpers.h"
-
-#define COUPLING_DISTANCE_THRESHOLD 35
-#define AVG_MIN_DISTANCE_THRESHOLD 20
+#include "PipelineConfig.h"
+#include "EdgeScores.h"
+#include "CandidateGraph.h"
+#include "ColourClusters.h"
+#include "MatchEdges.h"
 
 #define ROTATE_PADDING 50
 
-void get_edge_points(Edge* edge, vector<Point>& out)
-{
-	PieceData* pd = edge->piece();
-	int edge_index = edge->index();
-
-	ptIter edge_begin = pd->getEdgeBegin(edge_index);
-	ptIter edge_end = pd->getEdgeEnd(edge_index);
-	ptIter piece_begin = pd->begin();
-	ptIter piece_end = pd->end();
-
-	ptIter iter = edge_begin;
-
-	while(iter != edge_end)
-	{
-		out.push_back(*iter);
-
-		iter ++;
-
-		if (iter == piece_end && piece_end != edge_end)
-		{
-			iter = piece_begin;	
-		}		
-	}
-}
-
-void get_reverse_edge_points(Edge* edge, vector<Point>& out)
-{
-	PieceData* pd = edge->piece();
-	int edge_index = edge->index();
-
-	ptIter edge_begin = pd->getEdgeBegin(edge_index);
-	ptIter edge_end = pd->getEdgeEnd(edge_index);
-	ptIter piece_begin = pd->begin();
-	ptIter piece_end = pd->end();
-
-	ptIter iter = edge_end;
-
-	do 
-	{
-		iter --;
-
-		out.push_back(*iter);
-
-		if (iter == piece_begin && piece_begin != edge_begin)
-		{
-			iter = piece_end;	
-		}		
-	}
-	while(iter != edge_begin);
-}
-
-
-double compute_coupling_distance(vector<Point>& curveA, vector<Point>& curveB, int i, int j, vector<vector<double> >& ca)
-{
-	if (ca[i][j] > -1) return ca[i][j];
-
-	if (i == 0 && j == 0) 
-	{
-		ca[i][j] = euclid_distance(curveA[i], curveB[j]);
-	}
-	else if (i > 0 && j == 0) 
-	{
-		ca[i][j] = max(compute_coupling_distance(curveA, curveB, i - 1, j, ca), euclid_distance(curveA[i], curveB[j]));
-	}
-	else if (i == 0 && j > 0) 
-	{
-		ca[i][j] = max(compute_coupling_distance(curveA, curveB, i, j -1, ca), euclid_distance(curveA[i], curveB[j]));
-	}
-	else
-	{
-		// i > 0 && j > 0
-		double minus_i = compute_coupling_distance(curveA, curveB, i - 1, j, ca);
-		double minus_j = compute_coupling_distance(curveA, curveB, i, j -1, ca);
-		double minus_ij = compute_coupling_distance(curveA, curveB, i - 1, j - 1, ca);
-
-		ca[i][j] = max(min(minus_i, min(minus_j, minus_ij)), euclid_distance(curveA[i], curveB[j]));
-	}
-
-	//cout << i << ", " << j << " = " << ca[i][j] << endl;
+// Edges on each side of a block of pairs scored together by -k
+#define MATCH_BLOCK_EDGES 64
 
-	return ca[i][j];
-}
-
-double coupling_distance(Edge* edgeA, Edge* edgeB)
+void get_mated_edge_points(Edge* edgeOut, int length, vector<Point>& out)
 {
-	vector<Point> curveA;
-	vector<Point> curveB;
-
-	get_edge_points(edgeA, curveA);
-	get_reverse_edge_points(edgeB, curveB);
-	
-	vector<vector<double> > ca (curveA.size());
-
-	for (int i = 0; i < curveA.size(); i++) 
-	{
-		ca[i] = vector<double>(curveB.size());
-		for(int j = 0; j < curveB.size(); j++)
-		{
-			ca[i][j] = -1;
-		}
-	}
-
-	return compute_coupling_distance(curveA, curveB, curveA.size() - 1, curveB.size() - 1, ca);
-}
-
-double average_min_dist_measure(Edge* edgeA, Edge* edgeB)
-{
-	vector<Point> curveA;
-	vector<Point> curveB;
-
-	get_edge_points(edgeA, curveA);
-	get_edge_points(edgeB, curveB);
-
-	double total_min_distances = 0;
-
-	vector<Point>::iterator itA = curveA.begin();
-
-	while(++itA != curveA.end())
-	{
-		double min_distance = 99999;
-
-		vector<Point>::iterator itB = curveB.begin();
-
-		while(++itB != curveB.end())
-		{
-			double dist = euclid_distance(*itA, *itB);
-			
-			if (dist < min_distance)
-				min_distance = dist;
-		}
+	vector<Point> canonical;
+	edgeOut->canonicalPoints(canonical);
 
-		total_min_distances += min_distance;
-	}
-	
-	return total_min_distances / curveA.size();
+	mate_edge_points(canonical, length, out);
 }
 
-#define COLOUR_AVERAGE_COUNT 25
-vector<Scalar> avg_colour(Edge* edge, bool average_down = true)
+// Colour strip of an edge as worked out by the classifier. The strip of
+// an out edge runs the opposite way round to the in edge it fits against,
+// so it is reversed to line the columns up.
+vector<Scalar> colour_strip(Edge* edge, bool reversed = false)
 {
-	ptIter start = edge->begin();
-	ptIter end = edge->end();
-	Mat img = edge->piece()->image();
-
-	int width = abs((*start).x - (*end).x);
-	int origin_x = min((*start).x, (*end).x);
-	int y_offset = average_down ? 0 : -COLOUR_AVERAGE_COUNT;
-
-	vector<Scalar> colours (width);
-
-	ptIter iter = start;
-	ptIter nextIter = edge->piece()->increment(iter, 1, end);
+	vector<Vec3b>& strip = edge->piece()->getColourStrip(edge->index());
+	vector<Scalar> colours (strip.size());
 
-	while (nextIter != end)
+	for (int i = 0; i < strip.size(); i++)
 	{
-		int begin_x = (*iter).x;
-		int end_x = (*nextIter).x;
-		int begin_y = (*iter).y;
-		
-		if (begin_x > end_x)
-		{
-			int tmp = begin_x;
-			begin_x = end_x;
-			end_x = tmp;
-		}
-		
-		for (int x = begin_x; x < end_x; x++)
-		{
-			Rect roi (x, begin_y + y_offset, 1, COLOUR_AVERAGE_COUNT);
-
-			colours[x - origin_x] = mean(img(roi));
-		}
-
-		iter = nextIter;
-		nextIter = edge->piece()->increment(iter, 1, end);
+		Vec3b colour = reversed ? strip[strip.size() - 1 - i] : strip[i];
+		colours[i] = Scalar(colour[0], colour[1], colour[2]);
 	}
 
 	return colours;
 }
 
-/*
-vector<vector<double> > avg_colour(Edge* edge)
-{
-	ptIter start = edge->begin();
-	ptIter end = edge->end();
-	int dir = +1;
-
-	cout << *start << " " << *end << endl;
-
-	Point firstCorner = *start;
-	Point secondCorner = *end;
-
-	int width = abs(firstCorner.x - secondCorner.x);
-
-	vector<vector<double> > colours;
-	Mat img = edge->piece()->image();
-
-	ptIter iter = start;
-	ptIter nextIter = edge->piece()->increment(iter, dir, end);
-
-	int start_x = firstCorner.x;
-	int start_y = firstCorner.y;
-	int end_x = secondCorner.x;
-
-	cout << start_x << " " << end_x << endl;
-	cout << dir << endl;
-
-	while (nextIter != end)
-	{
-		int begin_x = (*iter).x;
-		int end_x = (*nextIter).x;
-		int begin_y = (*iter).y;
-		
-		if (begin_x > end_x)
-		{
-			int tmp = begin_x;
-			begin_x = end_x;
-			end_x = tmp;
-		}
-		
-		for (int x = begin_x; x < end_x; x++)
-		{
-			double r = 0;
-			double g = 0;
-			double b = 0;
-
-			for (int y = begin_y; y < begin_y + 50; y++)
-			{
-				Vec3b bgrPixel = img.at<Vec3b>(x, y);
-				b += (uchar)bgrPixel.val[0];
-				r += (uchar)bgrPixel.val[1];
-				g += (uchar)bgrPixel.val[2];
-			}
-
-			vector<double> channel_averages (3);
-			channel_averages[0] = b / 50;
-			channel_averages[1] = r / 50;
-			channel_averages[2] = g / 50;
-			
-			cout << "(" << x << ", " << begin_y << ") = ["<< channel_averages[0] << ", " << channel_averages[1] << ", " << channel_averages[2] << "] " <<endl;
-
-			colours.push_back(channel_averages);
-		}
-
-		iter = nextIter;
-		nextIter = edge->piece()->increment(iter, dir, end);
-	}
-
-	/*for (int x = start_x; x < end_x; x++)
-	{
-			cout << x << " " << (*iter).x << ", " << (*iter).y << endl;
-		if (x >= (*iter).x && iter != end)
-		{
-			iter = edge->piece()->increment(iter, dir, end);
-			start_y = (*iter).y;
-		}	
-	
-		double r = 0;
-		double g = 0;
-		double b = 0;
-		for (int y = start_y; y < start_y + 10; y++)
-		{
-			Vec3b bgrPixel = img.at<Vec3b>(x, y);
-			b += (uchar)bgrPixel.val[0];
-			r += (uchar)bgrPixel.val[1];
-			g += (uchar)bgrPixel.val[2];
-		}
-		
-		vector<double> channel_averages (3);
-		channel_averages[0] = r / 10;
-		channel_averages[1] = g / 10;
-		channel_averages[2] = b / 10;
-
-		//cout << "(" << x << ", " << start_y << ") = ["<< channel_averages[0] << ", " << channel_averages[1] << ", " << channel_averages[2] << "] " <<endl;
-
-		colours.push_back(channel_averages);
-	}
-
-	cout << firstCorner << secondCorner << img.size() << endl;
-
-	return colours;
-}*/
-
+// Draws the foreground over the background at location, black foreground
+// pixels being see-through. The black pixels become a mask so the copy is
+// done by copyTo over just the overlapping area.
 void overlayImage(const cv::Mat &background, const cv::Mat &foreground, cv::Mat &output, cv::Point2i location)
 {
-	background.copyTo(output);
-
-	// start at the row indicated by location, or at row 0 if location.y is negative.
-	for(int y = std::max(location.y , 0); y < background.rows; ++y)
-	{
-		int fY = y - location.y; // because of the translation
-		if(fY >= foreground.rows) break;
+	if (output.data != background.data) background.copyTo(output);
 
-		// start at the column indicated by location, 
-		// or at column 0 if location.x is negative.
+	Rect area = Rect(location, foreground.size()) & Rect(Point(0, 0), background.size());
+	if (area.width <= 0 || area.height <= 0) return;
 
-		for(int x = std::max(location.x, 0); x < background.cols; ++x)
-		{
-			int fX = x - location.x; // because of the translation.
-			// we are done with this row if the column is outside of the foreground image.
-			// determine the opacity of the foregrond pixel, using its fourth (alpha) channel.
-			double opacity = 1;
-			// and now combine the background and foreground pixel, using the opacity, 
-
-			unsigned char f_r = foreground.data[fY * foreground.step + fX * foreground.channels() + 0];
-			unsigned char f_g = foreground.data[fY * foreground.step + fX * foreground.channels() + 1];
-			unsigned char f_b = foreground.data[fY * foreground.step + fX * foreground.channels() + 2];
+	Mat source = foreground(Rect(area.tl() - location, area.size()));
+	Mat mask;
 
-			if (f_r == 0 && f_g == 0 && f_b == 0) opacity = 0;
+	inRange(source, Scalar(0, 0, 0), Scalar(0, 0, 0), mask);
+	bitwise_not(mask, mask);
 
-			// but only if opacity > 0.
-			for(int c = 0; opacity > 0 && c < output.channels(); ++c)
-			{
-				unsigned char foregroundPx = foreground.data[fY * foreground.step + fX * foreground.channels() + c];
-				unsigned char backgroundPx = background.data[y * background.step + x * background.channels() + c];
-				output.data[y*output.step + output.channels()*x + c] = backgroundPx * (1.-opacity) + foregroundPx * opacity;
-      			}
-		}
-	}
+	Mat target = output(area);
+	source.copyTo(target, mask);
 }
 
 void drawEdge(Mat display_img, PieceData* pd, int edge_index, Scalar color, int line_width, Point origin = Point(0, 0))
@@ -449,27 +180,33 @@ void display_colour(Edge* edge, vector<Scalar>& colours, String window_name)
 	imshow(window_name, display_img);
 }
 
-void display_edge_comparision(Edge* edgeIn, Edge* edgeOut, String window_name)
+void drawCurve(Mat display_img, vector<Point>& curve, Scalar color, int line_width, Point origin)
+{
+	for (int i = 1; i < curve.size(); i++)
+	{
+		line(display_img, curve[i - 1] + origin, curve[i] + origin, color, line_width);
+	}
+}
+
+void display_edge_comparision(vector<Point>& curveIn, vector<Point>& curveOut, String window_name)
 {
 	namedWindow(window_name, CV_WINDOW_AUTOSIZE);
 
-	Mat raw_img = edgeIn->piece()->image();
-	Mat display_img;
-	display_img.create(Size(600, 600), raw_img.type());
+	Mat display_img = Mat::zeros(Size(600, 600), CV_8UC3);
 
-	Point origin (20, 100);
+	Point origin (20, 300);
 	circle(display_img, origin, 6, Scalar(255, 255, 255), -1);
 
-	circle(display_img, edgeIn->getFirstCorner() + origin, 4, Scalar(255, 0, 0), -1);
-	circle(display_img, edgeIn->getSecondCorner() + origin, 4, Scalar(0, 0, 255), -1);
-	circle(display_img, edgeOut->getFirstCorner() + origin, 4, Scalar(255, 0, 0), -1);
-	circle(display_img, edgeOut->getSecondCorner() + origin, 4, Scalar(0, 0, 255), -1);
+	circle(display_img, curveIn.front() + origin, 4, Scalar(255, 0, 0), -1);
+	circle(display_img, curveIn.back() + origin, 4, Scalar(0, 0, 255), -1);
+	circle(display_img, curveOut.back() + origin, 4, Scalar(255, 0, 0), -1);
+	circle(display_img, curveOut.front() + origin, 4, Scalar(0, 0, 255), -1);
 
-	line(display_img, edgeIn->getFirstCorner() + origin, edgeIn->getSecondCorner() + origin, Scalar(128, 128, 128), 1);
-	line(display_img, edgeOut->getFirstCorner() + origin, edgeOut->getSecondCorner() + origin, Scalar(128, 128, 128), 1);
+	line(display_img, curveIn.front() + origin, curveIn.back() + origin, Scalar(128, 128, 128), 1);
+	line(display_img, curveOut.front() + origin, curveOut.back() + origin, Scalar(128, 128, 128), 1);
 
-	drawEdge(display_img, edgeIn, Scalar(0, 255, 0), 2, origin);
-	drawEdge(display_img, edgeOut, Scalar(255, 0, 0), 2, origin);
+	drawCurve(display_img, curveIn, Scalar(0, 255, 0), 2, origin);
+	drawCurve(display_img, curveOut, Scalar(255, 0, 0), 2, origin);
 
 	imshow(window_name, display_img);
 }
@@ -484,53 +221,220 @@ double getEdgeAtan(Edge* edge)
 	return angle;
 }
 
-int main(int argc, char* argv[]) 
+// How -a runs: top_k and shard for a candidate graph (see
+// candidate_graph), the number of colour clusters to split the pieces
+// into (0 for none) and a file labelling which puzzle each piece is from
+// to check the clusters against.
+struct MatchOptions
 {
-	string first_piece_filename = string(argv[1]);
-	string second_piece_filename = string(argv[2]);
+	int top_k;
+	MatchShard shard;
+	int cluster_count;
+	string labels_filename;
+	PipelineConfig config;
+};
+
+// How much the colour clusters cut out, and with a labels file (a line
+// per piece: name and puzzle) how many pairs of pieces from the same
+// puzzle they kept.
+void report_clusters(vector<string>& filenames, MatchEdges& edges, MatchOptions& options, long long pruned, long long scored)
+{
+	if (edges.clusters.count == 0) return;
 
-	int first_edge_index = atoi(argv[3]);
-	int second_edge_index = atoi(argv[4]);
+	cout << "Colour clusters " << edges.clusters.count << ", pruned " << pruned << " of " << pruned + scored << " edge pairs (";
+	cout << (pruned + scored > 0 ? 100.0 * pruned / (pruned + scored) : 0) << "%)" << endl;
 
-	Edge edge1 (first_piece_filename, first_edge_index);
-	Edge edge2 (second_piece_filename, second_edge_index);
+	if (options.labels_filename.size() == 0) return;
 
-	Edge* edgeIn = NULL;
-	Edge* edgeOut = NULL;
+	fstream fs (options.labels_filename.c_str(), fstream::in);
+	map<string, string> labels;
+	string name;
+	string label;
 
-	if (edge1.type() == EDGE_TYPE_FLAT)
+	while (fs >> name >> label) labels[name] = label;
+
+	long long same = 0;
+	long long kept = 0;
+
+	for (int p = 0; p < filenames.size(); p++)
 	{
-		cout << "First edge is flat." << endl;
-		display_edge(&edge1, "Edge A");
-		display_edge(&edge2, "Edge B");
+		if (labels.count(filenames[p]) == 0) continue;
 
-		waitKey();
-		return EXIT_FAILURE;
+		for (int q = p + 1; q < filenames.size(); q++)
+		{
+			if (labels.count(filenames[q]) == 0 || labels[filenames[p]] != labels[filenames[q]]) continue;
+
+			same++;
+			if (may_match(edges.clusters, p, q)) kept++;
+		}
 	}
 
-	if (edge2.type() == EDGE_TYPE_FLAT)
+	cout << "Recall on '" << options.labels_filename << "': " << kept << " of " << same << " same puzzle piece pairs kept (";
+	cout << (same > 0 ? 100.0 * kept / same : 0) << "%)" << endl;
+}
+
+// A line per piece with its name and edge types
+void write_match_pieces(fstream& fs, vector<string>& filenames, MatchEdges& edges)
+{
+	for (int p = 0; p < filenames.size(); p++)
 	{
-		cout << "Second edge is flat" << endl;
-		display_edge(&edge1, "Edge A");
-		display_edge(&edge2, "Edge B");
+		fs << filenames[p];
+		for (int e = 0; e < EDGE_COUNT; e++) fs << " " << edges.types[EDGE_ID(p, e)];
+		fs << endl;
+	}
+}
 
-		waitKey();
-		return EXIT_FAILURE;
+// Scores every in edge against every out edge of the other pieces and
+// writes the lot to one file for the solver. The file starts with the
+// piece count and the pieces (see write_match_pieces), then has a line
+// per edge pair: piece, edge, piece, edge and score, pieces numbered in
+// the order they were given. Pairs between pieces in colour clusters
+// that aren't adjacent are left out.
+int all_pairs(vector<string>& filenames, string scores_filename, MatchOptions& options)
+{
+	int piece_count = filenames.size();
+	MatchEdges edges;
+
+	if (!load_match_edges(filenames, edges, options.cluster_count)) return EXIT_FAILURE;
+
+	fstream fs (scores_filename.c_str(), fstream::out);
+
+	fs << piece_count << endl;
+	write_match_pieces(fs, filenames, edges);
+
+	int64 start = getTickCount();
+	long long pair_count = 0;
+	long long pruned_count = 0;
+
+	for (int a = 0; a < edges.types.size(); a++)
+	{
+		if (edges.types[a] != EDGE_TYPE_IN) continue;
+
+		EdgeField field;
+		build_edge_field(edges.curves[a], field);
+
+		for (int b = 0; b < edges.types.size(); b++)
+		{
+			if (edges.types[b] != EDGE_TYPE_OUT || EDGE_PIECE(a) == EDGE_PIECE(b)) continue;
+
+			if (!may_match(edges.clusters, EDGE_PIECE(a), EDGE_PIECE(b)))
+			{
+				pruned_count++;
+				continue;
+			}
+
+			fs << EDGE_PIECE(a) << " " << EDGE_INDEX(a) << " " << EDGE_PIECE(b) << " " << EDGE_INDEX(b) << " ";
+			fs << score_edge_pair(edges, field, a, b, options.config) << endl;
+			pair_count++;
+		}
 	}
 
-	if (edge1.type() == edge2.type())
+	fs.close();
+
+	double seconds = (getTickCount() - start) / getTickFrequency();
+
+	cout << "Scored " << pair_count << " edge pairs between " << piece_count << " pieces in " << seconds << "s" << endl;
+	report_clusters(filenames, edges, options, pruned_count, pair_count);
+	cout << "Scores written to '" << scores_filename << "'" << endl;
+
+	return EXIT_SUCCESS;
+}
+
+// Scores the same pairs as all_pairs but keeps only each edge's best
+// top_k candidates, in a bounded heap per edge, so memory goes with
+// edges * top_k rather than edges squared. Pairs are scored a block of
+// in edges against a block of out edges at a time so the curves being
+// compared stay in cache. The candidate graph is written in CSR form
+// with scores quantised to 16 bits, see EdgeScores.
+// With more than one shard only the shard's in edges are scored and the
+// candidates it found are written in full for MatchMerge to combine.
+int candidate_graph(vector<string>& filenames, string graph_filename, MatchOptions& options)
+{
+	int piece_count = filenames.size();
+	int top_k = options.top_k;
+	MatchShard shard = options.shard;
+	MatchEdges edges;
+
+	if (!load_match_edges(filenames, edges, options.cluster_count)) return EXIT_FAILURE;
+
+	vector<int> in_edges;
+	vector<int> out_edges;
+	int in_edge_number = 0;
+
+	for (int i = 0; i < edges.types.size(); i++)
 	{
-		cout << "Edges same type." << endl;
-		display_edge(&edge1, "Edge A");
-		display_edge(&edge2, "Edge B");
+		if (edges.types[i] == EDGE_TYPE_IN && in_shard(shard, in_edge_number++)) in_edges.push_back(i);
+		if (edges.types[i] == EDGE_TYPE_OUT) out_edges.push_back(i);
+	}
 
-		waitKey();
-		return EXIT_FAILURE;
+	int64 start = getTickCount();
+	long long pair_count = 0;
+	long long pruned_count = 0;
+
+	CandidateLists lists;
+	lists.names = filenames;
+	lists.types = edges.types;
+	lists.rows.resize(edges.types.size());
+	lists.top_k = top_k;
+
+	for (int in_block = 0; in_block < in_edges.size(); in_block += MATCH_BLOCK_EDGES)
+	{
+		int in_end = min(in_block + MATCH_BLOCK_EDGES, (int)in_edges.size());
+
+		// Distance fields of the block's in edges, used against every out block
+		vector<EdgeField> fields (in_end - in_block);
+		for (int i = in_block; i < in_end; i++) build_edge_field(edges.curves[in_edges[i]], fields[i - in_block]);
+
+		for (int out_block = 0; out_block < out_edges.size(); out_block += MATCH_BLOCK_EDGES)
+		{
+			int out_end = min(out_block + MATCH_BLOCK_EDGES, (int)out_edges.size());
+
+			for (int i = in_block; i < in_end; i++)
+			{
+				for (int o = out_block; o < out_end; o++)
+				{
+					int a = in_edges[i];
+					int b = out_edges[o];
+
+					if (EDGE_PIECE(a) == EDGE_PIECE(b)) continue;
+
+					if (!may_match(edges.clusters, EDGE_PIECE(a), EDGE_PIECE(b)))
+					{
+						pruned_count++;
+						continue;
+					}
+
+					double score = score_edge_pair(edges, fields[i - in_block], a, b, options.config);
+					EdgeCandidate candidateA = { b, score };
+					EdgeCandidate candidateB = { a, score };
+
+					keep_candidate(lists.rows[a], candidateA, top_k);
+					keep_candidate(lists.rows[b], candidateB, top_k);
+					pair_count++;
+				}
+			}
+		}
 	}
 
-	edgeIn = (edge1.type() == EDGE_TYPE_IN ? &edge1 : &edge2);
-	edgeOut = (edge1.type() == EDGE_TYPE_OUT ? &edge1 : &edge2);
+	if (shard.count > 1) write_partial_candidates(graph_filename, lists, shard);
+	else write_candidate_graph(graph_filename, lists);
+
+	double seconds = (getTickCount() - start) / getTickFrequency();
+
+	cout << "Scored " << pair_count << " edge pairs between " << piece_count << " pieces in " << seconds << "s, ";
+	cout << "keeping the top " << top_k << " per edge" << endl;
+	report_clusters(filenames, edges, options, pruned_count, pair_count);
+
+	if (shard.count > 1) cout << "Shard " << shard.index << "/" << shard.count << " candidates written to '" << graph_filename << "'" << endl;
+	else cout << "Candidate graph written to '" << graph_filename << "'" << endl;
 
+	return EXIT_SUCCESS;
+}
+
+// Shows both pieces turned so their edges face each other. Only used for
+// looking at a match, the scores don't need the images.
+void display_match(Edge* edgeIn, Edge* edgeOut, vector<Scalar>& coloursIn, vector<Scalar>& coloursOut)
+{
 	double angle = getEdgeAtan(edgeIn);
 	edgeIn->piece()->rotate(-angle);
 
@@ -545,23 +449,193 @@ int main(int argc, char* argv[])
 	edgeIn->piece()->setOrigin(-edgeIn->piece()->origin());
 	edgeOut->piece()->setOrigin(-edgeOut->piece()->origin());
 
-	vector<Scalar> v1 = avg_colour(edgeIn, true);
-	display_colour(edgeIn, v1, "Colours In");
+	display_colour(edgeIn, coloursIn, "Colours In");
+	display_colour(edgeOut, coloursOut, "Colours Out");
+}
+
+void display_mismatch(Edge* edgeA, Edge* edgeB, bool debug)
+{
+	if (!debug) return;
+
+	display_edge(edgeA, "Edge A");
+	display_edge(edgeB, "Edge B");
+
+	waitKey();
+}
+
+// argv should contain two pieces and the index of the edge of each to
+// compare, optionally after '-v' to show the match and '-p <preset>' to
+// pick the pipeline preset.
+// '-a <scores>' instead scores every edge pair between all the pieces
+// that follow it and writes them to the scores file for the Solver.
+// '-k <top_k>' with -a keeps only each edge's best top_k candidates and
+// writes them as a candidate graph, for puzzles too big for every pair.
+// '-s <i/n>' with -k scores only shard i of n, see MatchShard, writing
+// that shard's candidates for MatchMerge.
+// '-c <clusters>' with -a splits the pieces into that many colour clusters
+// and only compares pieces in the same or adjacent clusters.
+// '-l <labels>' with -c reports how many same puzzle pairs the clusters
+// kept, from a file with a line per piece: name and puzzle.
+int main(int argc, char* argv[]) 
+{
+	bool debug = false;
+	int arg_index = 1;
+	PipelineConfig config = default_pipeline_config();
+
+	string scores_filename;
+	int top_k = 0;
+	MatchShard shard = { 0, 1 };
+	int cluster_count = 0;
+	string labels_filename;
+
+	while (arg_index < argc && argv[arg_index][0] == '-')
+	{
+		if (strcmp(argv[arg_index], "-a") == 0 && arg_index + 1 < argc)
+		{
+			scores_filename = string(argv[arg_index + 1]);
+			arg_index += 2;
+			continue;
+		}
+
+		if (strcmp(argv[arg_index], "-k") == 0 && arg_index + 1 < argc)
+		{
+			top_k = max(atoi(argv[arg_index + 1]), 1);
+			arg_index += 2;
+			continue;
+		}
+
+		if (strcmp(argv[arg_index], "-c") == 0 && arg_index + 1 < argc)
+		{
+			cluster_count = min(max(atoi(argv[arg_index + 1]), 0), MAX_COLOUR_CLUSTERS);
+			arg_index += 2;
+			continue;
+		}
+
+		if (strcmp(argv[arg_index], "-l") == 0 && arg_index + 1 < argc)
+		{
+			labels_filename = string(argv[arg_index + 1]);
+			arg_index += 2;
+			continue;
+		}
+
+		if (strcmp(argv[arg_index], "-s") == 0 && arg_index + 1 < argc)
+		{
+			if (!parse_shard(string(argv[arg_index + 1]), shard))
+			{
+				cout << "Error on shard '" << argv[arg_index + 1] << "'. Expected i/n with 0 <= i < n." << endl;
+				return EXIT_FAILURE;
+			}
+
+			arg_index += 2;
+			continue;
+		}
+
+		if (strcmp(argv[arg_index], "-v") == 0)
+		{
+			debug = true;
+			arg_index++;
+			continue;
+		}
+
+		if (strcmp(argv[arg_index], "-p") == 0 && arg_index + 1 < argc)
+		{
+			if (!pipeline_preset(string(argv[arg_index + 1]), config))
+			{
+				cout << "Error on preset '" << argv[arg_index + 1] << "'. Expected one of " << pipeline_preset_names() << "." << endl;
+				return EXIT_FAILURE;
+			}
+
+			arg_index += 2;
+			continue;
+		}
+
+		break;
+	}
+
+	if (scores_filename.size() > 0)
+	{
+		vector<string> filenames (argv + arg_index, argv + argc);
+
+		if (shard.count > 1 && top_k == 0)
+		{
+			cout << "Error on shard '" << shard.index << "/" << shard.count << "'. Sharding needs -k." << endl;
+			return EXIT_FAILURE;
+		}
+
+		MatchOptions options = { top_k, shard, cluster_count, labels_filename, config };
+
+		if (top_k > 0) return candidate_graph(filenames, scores_filename, options);
+		return all_pairs(filenames, scores_filename, options);
+	}
+
+	if (argc - arg_index < 4)
+	{
+		cout << "Usage: EdgeMatcher [-v] [-p preset] piece piece edge edge" << endl;
+		cout << "       EdgeMatcher [-p preset] [-k top_k [-s i/n]] [-c clusters [-l labels]] -a scores piece..." << endl;
+		return EXIT_FAILURE;
+	}
+
+	string first_piece_filename = string(argv[arg_index]);
+	string second_piece_filename = string(argv[arg_index + 1]);
+
+	int first_edge_index = atoi(argv[arg_index + 2]);
+	int second_edge_index = atoi(argv[arg_index + 3]);
+
+	Edge edge1 (first_piece_filename, first_edge_index);
+	Edge edge2 (second_piece_filename, second_edge_index);
+
+	Edge* edgeIn = NULL;
+	Edge* edgeOut = NULL;
+
+	if (edge1.type() == EDGE_TYPE_FLAT)
+	{
+		cout << "First edge is flat." << endl;
+		display_mismatch(&edge1, &edge2, debug);
+		return EXIT_FAILURE;
+	}
 
-	vector<Scalar> v2 = avg_colour(edgeOut, false);
-	display_colour(edgeOut, v2, "Colours Out");
+	if (edge2.type() == EDGE_TYPE_FLAT)
+	{
+		cout << "Second edge is flat" << endl;
+		display_mismatch(&edge1, &edge2, debug);
+		return EXIT_FAILURE;
+	}
 
-	edgeIn->piece()->setOrigin(edgeIn->getSecondCorner());
-	edgeOut->piece()->setOrigin(edgeOut->getFirstCorner());
+	if (edge1.type() == edge2.type())
+	{
+		cout << "Edges same type." << endl;
+		display_mismatch(&edge1, &edge2, debug);
+		return EXIT_FAILURE;
+	}
 
+	edgeIn = (edge1.type() == EDGE_TYPE_IN ? &edge1 : &edge2);
+	edgeOut = (edge1.type() == EDGE_TYPE_OUT ? &edge1 : &edge2);
+
+	// Both edges in the in edge's frame, straight from the transforms the
+	// classifier stored with each piece
+	vector<Point> curveIn;
+	vector<Point> curveOut;
+
+	vector<Point> mated;
+
+	edgeIn->canonicalPoints(curveIn);
+	get_mated_edge_points(edgeOut, curveIn.back().x, mated);
 
-	display_edge_comparision(edgeIn, edgeOut, "Edge Comparision");
+	EdgeField field;
+	build_edge_field(curveIn, field);
 
-	double coupling_dist = coupling_distance(edgeIn, edgeOut);
-	double average_min_dist = average_min_dist_measure(edgeIn, edgeOut);
+	EdgePose pose = refine_edge_pose(field, mated);
+	apply_edge_pose(field, pose, mated, curveOut);
 
+	cout << "Pose " << TO_DEGREE(pose.angle) << " degrees, offset " << pose.offset << ", mean distance " << pose.score << endl;
 
-	if (coupling_dist <= COUPLING_DISTANCE_THRESHOLD && average_min_dist <= AVG_MIN_DISTANCE_THRESHOLD)
+	vector<Scalar> v1 = colour_strip(edgeIn);
+	vector<Scalar> v2 = colour_strip(edgeOut, true);
+
+	double coupling_dist = coupling_distance(curveIn, curveOut);
+	double average_min_dist = average_min_dist_measure(curveIn, curveOut);
+
+	if (coupling_dist <= config.coupling_distance_threshold && average_min_dist <= config.avg_min_distance_threshold)
 	{
 		cout << "MATCH" << endl;
 	}
@@ -572,6 +646,40 @@ int main(int argc, char* argv[])
 	cout << coupling_dist << endl;
 	cout << average_min_dist << endl;
 
-	waitKey();
+	double colour_dist = colour_strip_distance(v1, v2);
+
+	if (colour_dist < 0)
+	{
+		cout << "No colour strips, reclassify the pieces." << endl;
+	}
+	else
+	{
+		cout << colour_dist << endl;
+	}
+
+	SeamModel seamIn;
+	SeamModel seamOut;
+	build_seam_model(edgeIn->piece()->getSeamStrip(edgeIn->index()), seamIn);
+	build_seam_model(edgeOut->piece()->getSeamStrip(edgeOut->index()), seamOut);
+
+	double seam_dist = seam_distance(seamIn, seamOut);
+
+	if (seam_dist < 0)
+	{
+		cout << "No seam strips, reclassify the pieces." << endl;
+	}
+	else
+	{
+		cout << seam_dist << endl;
+	}
+
+	if (debug)
+	{
+		display_match(edgeIn, edgeOut, v1, v2);
+		display_edge_comparision(curveIn, curveOut, "Edge Comparision");
+
+		waitKey();
+	}
+
 	return EXIT_SUCCESS;
 }
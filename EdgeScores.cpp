@@ -0,0 +1,265 @@
+#include "EdgeScores.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+// Ties go to the lower edge id so the best top_k of a set of candidates
+// doesn't depend on the order they were seen in
+bool candidate_better(const EdgeCandidate& a, const EdgeCandidate& b)
+{
+	if (a.score != b.score) return a.score < b.score;
+	return a.edge < b.edge;
+}
+
+// Keeps the best top_k candidates in a heap with the worst kept on top.
+// False if the candidate was turned away or pushed another out, that is
+// if the edge now has more candidates than it keeps.
+bool keep_candidate(vector<EdgeCandidate>& heap, EdgeCandidate candidate, int top_k)
+{
+	if (heap.size() < top_k)
+	{
+		heap.push_back(candidate);
+		push_heap(heap.begin(), heap.end(), candidate_better);
+		return true;
+	}
+
+	if (top_k > 0 && candidate_better(candidate, heap.front()))
+	{
+		pop_heap(heap.begin(), heap.end(), candidate_better);
+		heap.back() = candidate;
+		push_heap(heap.begin(), heap.end(), candidate_better);
+	}
+
+	return false;
+}
+
+long long pair_key(int edgeA, int edgeB)
+{
+	return (long long)min(edgeA, edgeB) << 32 | max(edgeA, edgeB);
+}
+
+// Only an in edge and an out edge can fit together
+bool can_pair(int typeA, int typeB)
+{
+	return (typeA == EDGE_TYPE_IN && typeB == EDGE_TYPE_OUT) || (typeA == EDGE_TYPE_OUT && typeB == EDGE_TYPE_IN);
+}
+
+EdgeScores::EdgeScores(string filename, int top_k)
+{
+	fstream fs (filename.c_str(), fstream::in);
+
+	string first;
+	if (!(fs >> first)) throw runtime_error("Failed to read scores");
+
+	if (first == CANDIDATE_GRAPH_MAGIC)
+	{
+		readGraph(fs, top_k);
+	}
+	else
+	{
+		readPieces(fs, atoi(first.c_str()));
+		readPairs(fs);
+	}
+
+	findBestBuddies();
+}
+
+void EdgeScores::readPieces(fstream& fs, int piece_count)
+{
+	if (piece_count <= 0) throw runtime_error("Failed to read piece count");
+
+	m_names.resize(piece_count);
+	m_edgeTypes.resize(piece_count * EDGE_COUNT);
+
+	for (int p = 0; p < piece_count; p++)
+	{
+		fs >> m_names[p];
+
+		for (int e = 0; e < EDGE_COUNT; e++)
+		{
+			fs >> m_edgeTypes[EDGE_ID(p, e)];
+		}
+	}
+
+	if (!fs) throw runtime_error("Failed to read pieces");
+}
+
+// Every pair written out, all of them kept so nothing is cut short.
+void EdgeScores::readPairs(fstream& fs)
+{
+	int edge_count = m_edgeTypes.size();
+	vector<vector<EdgeCandidate> > rows (edge_count);
+
+	m_truncated.assign(edge_count, false);
+
+	int p, e, q, f;
+	double pair_score;
+
+	while (fs >> p >> e >> q >> f >> pair_score)
+	{
+		int edgeA = EDGE_ID(p, e);
+		int edgeB = EDGE_ID(q, f);
+
+		EdgeCandidate candidateA = { edgeB, pair_score };
+		EdgeCandidate candidateB = { edgeA, pair_score };
+
+		rows[edgeA].push_back(candidateA);
+		rows[edgeB].push_back(candidateB);
+		m_pairScores[pair_key(edgeA, edgeB)] = pair_score;
+	}
+
+	m_offsets.assign(edge_count + 1, 0);
+	for (int i = 0; i < edge_count; i++)
+	{
+		m_offsets[i + 1] = m_offsets[i] + rows[i].size();
+	}
+
+	m_candidates.resize(m_offsets[edge_count]);
+	for (int i = 0; i < edge_count; i++)
+	{
+		sort(rows[i].begin(), rows[i].end(), candidate_better);
+		copy(rows[i].begin(), rows[i].end(), m_candidates.begin() + m_offsets[i]);
+	}
+}
+
+// A candidate graph from EdgeMatcher -k, already sorted. Rows as long as
+// the graph's k may have been cut short. Rows longer than top_k are cut
+// down to it.
+void EdgeScores::readGraph(fstream& fs, int top_k)
+{
+	int piece_count;
+	int graph_k;
+	double scale;
+
+	if (!(fs >> piece_count >> graph_k >> scale)) throw runtime_error("Failed to read graph header");
+
+	readPieces(fs, piece_count);
+
+	int edge_count = m_edgeTypes.size();
+	vector<int> file_offsets (edge_count + 1);
+
+	for (int i = 0; i <= edge_count; i++)
+	{
+		fs >> file_offsets[i];
+	}
+
+	if (!fs) throw runtime_error("Failed to read graph offsets");
+
+	m_offsets.assign(edge_count + 1, 0);
+	m_truncated.assign(edge_count, false);
+	m_candidates.reserve(min(file_offsets[edge_count], edge_count * max(top_k, 0)));
+
+	for (int i = 0; i < edge_count; i++)
+	{
+		int row_size = file_offsets[i + 1] - file_offsets[i];
+
+		for (int c = 0; c < row_size; c++)
+		{
+			EdgeCandidate candidate;
+			int level;
+
+			if (!(fs >> candidate.edge >> level)) throw runtime_error("Failed to read graph row");
+
+			candidate.score = level / scale;
+
+			if (c < top_k) m_candidates.push_back(candidate);
+		}
+
+		m_offsets[i + 1] = m_candidates.size();
+		m_truncated[i] = row_size >= graph_k || row_size > top_k;
+	}
+}
+
+// Two edges are best buddies if each is the other's best candidate.
+void EdgeScores::findBestBuddies()
+{
+	m_bestBuddies.assign(m_edgeTypes.size(), -1);
+
+	for (int i = 0; i < m_edgeTypes.size(); i++)
+	{
+		if (candidateCount(i) == 0) continue;
+
+		int best = candidates(i)[0].edge;
+
+		if (candidateCount(best) > 0 && candidates(best)[0].edge == i) m_bestBuddies[i] = best;
+	}
+}
+
+int EdgeScores::pieceCount()
+{
+	return m_names.size();
+}
+
+int EdgeScores::edgeCount()
+{
+	return m_edgeTypes.size();
+}
+
+string EdgeScores::pieceName(int piece)
+{
+	return m_names[piece];
+}
+
+int EdgeScores::edgeType(int edge_id)
+{
+	return m_edgeTypes[edge_id];
+}
+
+// NO_SCORE if the two edges can't fit together. From a candidate graph a
+// pair kept by neither edge scores at least the worst kept score of
+// whichever were truncated.
+double EdgeScores::score(int edgeA, int edgeB)
+{
+	if (EDGE_PIECE(edgeA) == EDGE_PIECE(edgeB) || !can_pair(m_edgeTypes[edgeA], m_edgeTypes[edgeB])) return NO_SCORE;
+
+	if (m_pairScores.size() > 0)
+	{
+		unordered_map<long long, double>::iterator it = m_pairScores.find(pair_key(edgeA, edgeB));
+		return it == m_pairScores.end() ? NO_SCORE : it->second;
+	}
+
+	double bound = NO_SCORE;
+	int edges[2] = { edgeA, edgeB };
+
+	for (int i = 0; i < 2; i++)
+	{
+		int edge = edges[i];
+		int other = edges[1 - i];
+
+		for (int c = m_offsets[edge]; c < m_offsets[edge + 1]; c++)
+		{
+			if (m_candidates[c].edge == other) return m_candidates[c].score;
+		}
+
+		if (m_truncated[edge] && candidateCount(edge) > 0)
+		{
+			double worst = m_candidates[m_offsets[edge + 1] - 1].score;
+			bound = (bound == NO_SCORE) ? worst : max(bound, worst);
+		}
+	}
+
+	return bound;
+}
+
+EdgeCandidate* EdgeScores::candidates(int edge_id)
+{
+	return m_candidates.data() + m_offsets[edge_id];
+}
+
+int EdgeScores::candidateCount(int edge_id)
+{
+	return m_offsets[edge_id + 1] - m_offsets[edge_id];
+}
+
+// Whether the edge had more candidates than were kept
+bool EdgeScores::truncated(int edge_id)
+{
+	return m_truncated[edge_id];
+}
+
+// -1 if the edge has no best buddy
+int EdgeScores::bestBuddy(int edge_id)
+{
+	return m_bestBuddies[edge_id];
+}
@@ -0,0 +1,84 @@
+#ifndef _EDGE_SCORES_
+#define _EDGE_SCORES_
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <cmath>
+
+#include "PieceData.h"
+
+// Edges are numbered across all the pieces
+#define EDGE_ID(piece, edge) ((piece) * EDGE_COUNT + (edge))
+#define EDGE_PIECE(edge_id) ((edge_id) / EDGE_COUNT)
+#define EDGE_INDEX(edge_id) ((edge_id) % EDGE_COUNT)
+
+#define NO_SCORE HUGE_VAL
+
+// Candidates kept per edge when reading a candidate graph
+#define SCORES_TOP_K 32
+
+// The first word of a candidate graph file, see EdgeScores
+#define CANDIDATE_GRAPH_MAGIC "CSR"
+
+// Quantised scores in a candidate graph run 0 to this
+#define CANDIDATE_GRAPH_LEVELS 65535
+
+using namespace std;
+
+struct EdgeCandidate
+{
+	int edge;
+	double score;
+};
+
+// The edge pair scores written by EdgeMatcher -a, either every pair or
+// the top-k candidate graph from -k. Candidates are held in one array
+// indexed by per edge offsets (CSR), sorted best (lowest score) first.
+// A file of every pair is kept whole, with the scores also looked up by
+// pair, so solving from it is exact. From a candidate graph only each
+// edge's best top_k are kept, so memory goes with edges * top_k. An edge
+// whose candidates were cut short is truncated, pairs past its last
+// candidate are taken to score its worst kept score.
+//
+// A candidate graph file is
+//	CSR piece_count k scale
+//	name type type type type	(per piece)
+//	offsets				(edges + 1 of them)
+//	edge score edge score ...	(per edge, score quantised by scale)
+class EdgeScores
+{
+	private:
+		vector<string> m_names;
+		vector<int> m_edgeTypes;
+		vector<int> m_offsets;
+		vector<EdgeCandidate> m_candidates;
+		vector<bool> m_truncated;
+		unordered_map<long long, double> m_pairScores;
+		vector<int> m_bestBuddies;
+
+		void readPairs(fstream& fs);
+		void readGraph(fstream& fs, int top_k);
+		void readPieces(fstream& fs, int piece_count);
+		void findBestBuddies();
+
+	public:
+		EdgeScores(string filename, int top_k = SCORES_TOP_K);
+
+		int pieceCount();
+		int edgeCount();
+		string pieceName(int piece);
+		int edgeType(int edge_id);
+
+		double score(int edgeA, int edgeB);
+		EdgeCandidate* candidates(int edge_id);
+		int candidateCount(int edge_id);
+		bool truncated(int edge_id);
+		int bestBuddy(int edge_id);
+};
+
+bool candidate_better(const EdgeCandidate& a, const EdgeCandidate& b);
+bool keep_candidate(vector<EdgeCandidate>& heap, EdgeCandidate candidate, int top_k);
+bool can_pair(int typeA, int typeB);
+
+#endif
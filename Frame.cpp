@@ -0,0 +1,309 @@
+#include "Frame.h"
+
+#include <algorithm>
+#include <cmath>
+
+//--- Forward declarations
+bool build_chain(EdgeScores& scores, vector<int>& kinds, vector<int>& flats, int start, int side_lengths[4], vector<int>& chain, double& cost);
+int chain_prev_edge(int kind, int flat);
+int chain_next_edge(int kind, int flat);
+//---
+
+// Whether a piece is a corner (two adjacent flat edges), a border piece
+// (one flat edge) or neither. flat is set to the flat edge, for a corner
+// the one followed by the other going round the piece.
+int piece_kind(EdgeScores& scores, int piece, int& flat)
+{
+	int flat_count = 0;
+	flat = -1;
+
+	for (int e = 0; e < EDGE_COUNT; e++)
+	{
+		if (scores.edgeType(EDGE_ID(piece, e)) != EDGE_TYPE_FLAT) continue;
+
+		flat_count++;
+
+		if (flat < 0 || scores.edgeType(EDGE_ID(piece, (e + 1) % EDGE_COUNT)) == EDGE_TYPE_FLAT) flat = e;
+	}
+
+	if (flat_count == 1) return PIECE_BORDER;
+
+	if (flat_count == 2 && scores.edgeType(EDGE_ID(piece, (flat + 1) % EDGE_COUNT)) == EDGE_TYPE_FLAT) return PIECE_CORNER;
+
+	return PIECE_INTERIOR;
+}
+
+// Going round the frame clockwise, the edge of a piece joined to the
+// piece before it and the edge joined to the piece after it. With a
+// border piece's flat edge at the top these are its left and right edges,
+// with a corner's flat edges top and left they are its bottom and right.
+int chain_prev_edge(int kind, int flat)
+{
+	return (flat + (kind == PIECE_CORNER ? 2 : 1)) % EDGE_COUNT;
+}
+
+int chain_next_edge(int kind, int flat)
+{
+	return (flat + 3) % EDGE_COUNT;
+}
+
+// Solves the border of the puzzle on its own and places it into the
+// (empty) assembly, so the interior is filled inside a known frame.
+// Only border to border scores are used. The frame size comes from the
+// piece counts: 2(w + h) - 4 border pieces and w * h pieces in all.
+// The frame is built as a chain going clockwise from a corner, each step
+// adding an unused piece of the kind the frame needs next: a border piece
+// until the side is long enough, then a corner, keeping a beam of the
+// cheapest chains so far (see build_chain). The chain must close back onto
+// its first corner. Every corner is tried as the start with both ways
+// round of the width and height, and the cheapest closed chain wins.
+// False if the pieces can't make a frame.
+bool solve_frame(EdgeScores& scores, Assembly& assembly, FrameStats& stats)
+{
+	int piece_count = scores.pieceCount();
+	vector<int> kinds (piece_count);
+	vector<int> flats (piece_count);
+	vector<int> corners;
+
+	stats.corners = 0;
+	stats.borders = 0;
+	stats.width = 0;
+	stats.height = 0;
+	stats.cost = 0;
+
+	for (int p = 0; p < piece_count; p++)
+	{
+		kinds[p] = piece_kind(scores, p, flats[p]);
+
+		if (kinds[p] == PIECE_CORNER) corners.push_back(p);
+		if (kinds[p] == PIECE_BORDER) stats.borders++;
+	}
+
+	stats.corners = corners.size();
+
+	if (stats.corners != 4) return false;
+
+	// w + h and w * h give the frame size
+	double sum = (stats.borders + 8) / 2.0;
+	double discriminant = sum * sum - 4.0 * piece_count;
+
+	if (discriminant < 0) return false;
+
+	int width = (int)floor((sum + sqrt(discriminant)) / 2 + 0.5);
+	int height = (int)floor(sum + 0.5) - width;
+
+	if (width < 2 || height < 2 || 2 * (width + height) - 8 != stats.borders) return false;
+
+	vector<int> best_chain;
+	double best_cost = 0;
+	int best_sides[4];
+
+	for (int c = 0; c < corners.size(); c++)
+	{
+		for (int turn = 0; turn < 2; turn++)
+		{
+			int across = (turn == 0 ? width : height) - 2;
+			int down = (turn == 0 ? height : width) - 2;
+			int side_lengths[4] = { across, down, across, down };
+
+			vector<int> chain;
+			double cost;
+
+			if (!build_chain(scores, kinds, flats, corners[c], side_lengths, chain, cost)) continue;
+
+			if (best_chain.size() == 0 || cost < best_cost)
+			{
+				best_chain = chain;
+				best_cost = cost;
+				copy(side_lengths, side_lengths + 4, best_sides);
+			}
+		}
+	}
+
+	if (best_chain.size() == 0) return false;
+
+	// Lay the chain out clockwise from the top left, each piece turned so
+	// its flat edges face out of the frame
+	int side_directions[4] = { EDGE_RIGHT, EDGE_BOT, EDGE_LEFT, EDGE_TOP };
+	int outward[4] = { EDGE_TOP, EDGE_RIGHT, EDGE_BOT, EDGE_LEFT };
+
+	int x = 0;
+	int y = 0;
+	int index = 0;
+
+	for (int side = 0; side < 4; side++)
+	{
+		// The corner starting the side has its first flat edge facing
+		// out of this side and the other out of the previous side
+		int corner = best_chain[index++];
+		assembly.place(corner, x, y, (outward[side] - flats[corner] + EDGE_COUNT) % EDGE_COUNT);
+
+		for (int i = 0; i < best_sides[side]; i++)
+		{
+			Point offset = direction_offset(side_directions[side]);
+			x += offset.x;
+			y += offset.y;
+
+			int piece = best_chain[index++];
+			assembly.place(piece, x, y, (outward[side] - flats[piece] + EDGE_COUNT) % EDGE_COUNT);
+		}
+
+		Point offset = direction_offset(side_directions[side]);
+		x += offset.x;
+		y += offset.y;
+	}
+
+	stats.width = best_sides[0] + 2;
+	stats.height = best_sides[1] + 2;
+	stats.cost = best_cost;
+
+	return true;
+}
+
+// A frame chain being built: the pieces so far, which are used, the
+// total of its joins and the edge the next piece joins onto
+struct FrameChain
+{
+	vector<int> pieces;
+	vector<bool> used;
+	double cost;
+	int next_edge;
+};
+
+bool chain_cheaper(const FrameChain& a, const FrameChain& b)
+{
+	return a.cost < b.cost;
+}
+
+// The best FRAME_BRANCHES unused pieces of the wanted kind to join onto
+// the chain's next edge, from the edge's candidates. When those run out
+// (they are only the top few) the rest of the pieces of that kind are
+// scored directly.
+void chain_branches(EdgeScores& scores, vector<int>& kinds, vector<int>& flats, vector<int>& kind_pieces, FrameChain& chain, int wanted, vector<EdgeCandidate>& branches)
+{
+	branches.clear();
+
+	EdgeCandidate* candidates = scores.candidates(chain.next_edge);
+
+	for (int c = 0; c < scores.candidateCount(chain.next_edge) && branches.size() < FRAME_BRANCHES; c++)
+	{
+		int piece = EDGE_PIECE(candidates[c].edge);
+
+		if (chain.used[piece] || kinds[piece] != wanted) continue;
+		if (EDGE_INDEX(candidates[c].edge) != chain_prev_edge(wanted, flats[piece])) continue;
+
+		branches.push_back(candidates[c]);
+	}
+
+	if (branches.size() == FRAME_BRANCHES) return;
+
+	vector<EdgeCandidate> rest;
+
+	for (int i = 0; i < kind_pieces.size(); i++)
+	{
+		int piece = kind_pieces[i];
+		if (chain.used[piece]) continue;
+
+		EdgeCandidate candidate = { EDGE_ID(piece, chain_prev_edge(wanted, flats[piece])), 0 };
+
+		bool taken = false;
+		for (int b = 0; b < branches.size(); b++) taken = taken || branches[b].edge == candidate.edge;
+		if (taken) continue;
+
+		candidate.score = scores.score(chain.next_edge, candidate.edge);
+		if (candidate.score != NO_SCORE) rest.push_back(candidate);
+	}
+
+	sort(rest.begin(), rest.end(), candidate_better);
+
+	for (int i = 0; i < rest.size() && branches.size() < FRAME_BRANCHES; i++) branches.push_back(rest[i]);
+}
+
+// Builds the frame chain from the start corner, see solve_frame. The
+// chain is the corner then each side's border pieces followed by the next
+// corner, the last side ending back at the start. It is a beam search:
+// the FRAME_BEAM_WIDTH cheapest partial chains are each extended by their
+// FRAME_BRANCHES best next pieces, so one poor pick early on doesn't stop
+// the chain closing. Finished chains are ranked with the join closing
+// them onto the start. cost is the total of the scores of every join.
+bool build_chain(EdgeScores& scores, vector<int>& kinds, vector<int>& flats, int start, int side_lengths[4], vector<int>& chain, double& cost)
+{
+	vector<int> border_pieces;
+	vector<int> corner_pieces;
+
+	for (int p = 0; p < kinds.size(); p++)
+	{
+		if (kinds[p] == PIECE_BORDER) border_pieces.push_back(p);
+		if (kinds[p] == PIECE_CORNER) corner_pieces.push_back(p);
+	}
+
+	FrameChain first;
+	first.pieces.push_back(start);
+	first.used.assign(kinds.size(), false);
+	first.used[start] = true;
+	first.cost = 0;
+	first.next_edge = EDGE_ID(start, chain_next_edge(PIECE_CORNER, flats[start]));
+
+	vector<FrameChain> beam (1, first);
+	vector<EdgeCandidate> branches;
+
+	for (int side = 0; side < 4; side++)
+	{
+		// The last side ends on the start corner, closed below
+		int steps = side_lengths[side] + (side < 3 ? 1 : 0);
+
+		for (int i = 0; i < steps; i++)
+		{
+			int wanted = (i < side_lengths[side]) ? PIECE_BORDER : PIECE_CORNER;
+			vector<FrameChain> next;
+
+			for (int b = 0; b < beam.size(); b++)
+			{
+				chain_branches(scores, kinds, flats, wanted == PIECE_BORDER ? border_pieces : corner_pieces, beam[b], wanted, branches);
+
+				for (int c = 0; c < branches.size(); c++)
+				{
+					int piece = EDGE_PIECE(branches[c].edge);
+
+					FrameChain extended = beam[b];
+					extended.pieces.push_back(piece);
+					extended.used[piece] = true;
+					extended.cost += branches[c].score;
+					extended.next_edge = EDGE_ID(piece, chain_next_edge(wanted, flats[piece]));
+
+					next.push_back(extended);
+				}
+			}
+
+			if (next.size() == 0) return false;
+
+			sort(next.begin(), next.end(), chain_cheaper);
+			if (next.size() > FRAME_BEAM_WIDTH) next.resize(FRAME_BEAM_WIDTH);
+
+			beam.swap(next);
+		}
+	}
+
+	int start_edge = EDGE_ID(start, chain_prev_edge(PIECE_CORNER, flats[start]));
+	int best = -1;
+	double best_cost = 0;
+
+	for (int b = 0; b < beam.size(); b++)
+	{
+		double closing = scores.score(beam[b].next_edge, start_edge);
+		if (closing == NO_SCORE) continue;
+
+		if (best < 0 || beam[b].cost + closing < best_cost)
+		{
+			best = b;
+			best_cost = beam[b].cost + closing;
+		}
+	}
+
+	if (best < 0) return false;
+
+	chain = beam[best].pieces;
+	cost = best_cost;
+
+	return true;
+}
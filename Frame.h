@@ -0,0 +1,31 @@
+#ifndef _FRAME_
+#define _FRAME_
+
+#include "EdgeScores.h"
+#include "Assembly.h"
+
+#define PIECE_INTERIOR 0
+#define PIECE_BORDER 1
+#define PIECE_CORNER 2
+
+// Partial chains kept, and next pieces tried for each, while building the
+// frame
+#define FRAME_BEAM_WIDTH 32
+#define FRAME_BRANCHES 4
+
+using namespace std;
+
+// What solving the frame found
+struct FrameStats
+{
+	int corners;
+	int borders;
+	int width;
+	int height;
+	double cost;
+};
+
+bool solve_frame(EdgeScores& scores, Assembly& assembly, FrameStats& stats);
+int piece_kind(EdgeScores& scores, int piece, int& flat);
+
+#endif
@@ -35,6 +35,33 @@ double interior_angle_d(Point middle_vertex, Point prev_vertex, Point next_verte
 	return TO_DEGREE(interior_angle(middle_vertex, prev_vertex, next_vertex));
 }
 
+// Converts an allowed difference from 90 degrees into the tolerance
+// within_right_angle takes. Work it out once and keep it, not per test.
+double right_angle_tolerance(double degrees)
+{
+	double s = sin(TO_RAD(degrees));
+
+	return s * s;
+}
+
+// True if the interior angle at middle_vertex is within the tolerance of
+// 90 degrees, without the square roots or acos of interior_angle_d.
+// |angle - 90| <= d is the same as |cos(angle)| <= sin(d), and squaring
+// both sides of |u.v| <= sin(d)|u||v| leaves only multiplies.
+bool within_right_angle(Point middle_vertex, Point prev_vertex, Point next_vertex, double tolerance)
+{
+	double x_diff1 = middle_vertex.x - prev_vertex.x;
+	double x_diff2 = middle_vertex.x - next_vertex.x;
+	double y_diff1 = middle_vertex.y - prev_vertex.y;
+	double y_diff2 = middle_vertex.y - next_vertex.y;
+
+	double dot_product = x_diff1 * x_diff2 + y_diff1 * y_diff2;
+	double m1_sq = x_diff1 * x_diff1 + y_diff1 * y_diff1;
+	double m2_sq = x_diff2 * x_diff2 + y_diff2 * y_diff2;
+
+	return dot_product * dot_product <= tolerance * m1_sq * m2_sq;
+}
+
 double area_of_rectangle(Point middle_vertex, Point prev_vertex, Point next_vertex) 
 {
 	double length1 = euclid_distance(middle_vertex, prev_vertex);
@@ -59,11 +86,7 @@ int estimate_contour_area(vector<Point>& contour)
 
 double distance_from_line(double cx, double cy, double ax, double ay, double bx, double by)
 {
-	double r_numerator = (cx-ax)*(bx-ax) + (cy-ay)*(by-ay);
 	double r_denomenator = (bx-ax)*(bx-ax) + (by-ay)*(by-ay);
-	double r = r_numerator / r_denomenator;
-   	double px = ax + r*(bx-ax);
-  	double py = ay + r*(by-ay);
 	double s =  ((ay-cy)*(bx-ax)-(ax-cx)*(by-ay) ) / r_denomenator;
 
 	return fabs(s)*sqrt(r_denomenator);
@@ -74,6 +97,17 @@ double distance_from_line(Point p, Point l1, Point l2)
 	return distance_from_line(p.x, p.y, l1.x, l1.y, l2.x, l2.y);
 }
 
+// Squared distance from p to the line through l1 and l2. No square root,
+// so use this when only comparing distances.
+double squared_distance_from_line(Point p, Point l1, Point l2)
+{
+	double dx = l2.x - l1.x;
+	double dy = l2.y - l1.y;
+	double cross = (l1.y - p.y) * dx - (l1.x - p.x) * dy;
+
+	return cross * cross / (dx * dx + dy * dy);
+}
+
 int side_of_line(Point a, Point b, Point c)
 {
      return ((b.x - a.x)*(c.y - a.y) - (b.y - a.y)*(c.x - a.x)) > 0 ? 1 : -1;
@@ -15,6 +15,9 @@ double euclid_distance(Point p1, Point p2);
 double interior_angle(Point middle_vertex, Point prev_vertex, Point next_vertex);
 double interior_angle_d(Point middle_vertex, Point prev_vertex, Point next_vertex);
 
+double right_angle_tolerance(double degrees);
+bool within_right_angle(Point middle_vertex, Point prev_vertex, Point next_vertex, double tolerance);
+
 double area_of_rectangle(Point middle_vertex, Point prev_vertex, Point next_vertex);
 
 Rect contour_bounding_rect(vector<Point>& contour);
@@ -22,6 +25,7 @@ int estimate_contour_area(vector<Point>& contour);
 
 double distance_from_line(double cx, double cy, double ax, double ay, double bx, double by);
 double distance_from_line(Point p, Point l1, Point l2);
+double squared_distance_from_line(Point p, Point l1, Point l2);
 int side_of_line(Point a, Point b, Point c);
 Point midpoint_of_line(Point a, Point b);
 
@@ -0,0 +1,210 @@
+#include "MatchEdges.h"
+
+#include <iostream>
+#include <cstdlib>
+#include <stdexcept>
+
+#include "GeometryHelpers.h"
+
+// The points of an out edge (in its own frame) placed against an in edge
+// of the given length, in the in edge's frame. The out edge is turned half
+// way round so its first corner sits on the in edge's second corner, and
+// the points are reversed so both curves run the same way.
+void mate_edge_points(vector<Point>& canonical, int length, vector<Point>& out)
+{
+	for (int i = canonical.size() - 1; i >= 0; i--)
+	{
+		out.push_back(Point(length - canonical[i].x, -canonical[i].y));
+	}
+}
+
+double compute_coupling_distance(vector<Point>& curveA, vector<Point>& curveB, int i, int j, vector<vector<double> >& ca)
+{
+	if (ca[i][j] > -1) return ca[i][j];
+
+	if (i == 0 && j == 0) 
+	{
+		ca[i][j] = euclid_distance(curveA[i], curveB[j]);
+	}
+	else if (i > 0 && j == 0) 
+	{
+		ca[i][j] = max(compute_coupling_distance(curveA, curveB, i - 1, j, ca), euclid_distance(curveA[i], curveB[j]));
+	}
+	else if (i == 0 && j > 0) 
+	{
+		ca[i][j] = max(compute_coupling_distance(curveA, curveB, i, j -1, ca), euclid_distance(curveA[i], curveB[j]));
+	}
+	else
+	{
+		// i > 0 && j > 0
+		double minus_i = compute_coupling_distance(curveA, curveB, i - 1, j, ca);
+		double minus_j = compute_coupling_distance(curveA, curveB, i, j -1, ca);
+		double minus_ij = compute_coupling_distance(curveA, curveB, i - 1, j - 1, ca);
+
+		ca[i][j] = max(min(minus_i, min(minus_j, minus_ij)), euclid_distance(curveA[i], curveB[j]));
+	}
+
+	//cout << i << ", " << j << " = " << ca[i][j] << endl;
+
+	return ca[i][j];
+}
+
+double coupling_distance(vector<Point>& curveA, vector<Point>& curveB)
+{
+	vector<vector<double> > ca (curveA.size());
+
+	for (int i = 0; i < curveA.size(); i++) 
+	{
+		ca[i] = vector<double>(curveB.size());
+		for(int j = 0; j < curveB.size(); j++)
+		{
+			ca[i][j] = -1;
+		}
+	}
+
+	return compute_coupling_distance(curveA, curveB, curveA.size() - 1, curveB.size() - 1, ca);
+}
+
+double average_min_dist_measure(vector<Point>& curveA, vector<Point>& curveB)
+{
+	double total_min_distances = 0;
+
+	vector<Point>::iterator itA = curveA.begin();
+
+	while(++itA != curveA.end())
+	{
+		double min_distance = 99999;
+
+		vector<Point>::iterator itB = curveB.begin();
+
+		while(++itB != curveB.end())
+		{
+			double dist = euclid_distance(*itA, *itB);
+			
+			if (dist < min_distance)
+				min_distance = dist;
+		}
+
+		total_min_distances += min_distance;
+	}
+	
+	return total_min_distances / curveA.size();
+}
+
+// Mean absolute channel difference between two colour strips, the second
+// is stretched to the length of the first. -1 if either is missing.
+double colour_strip_distance(vector<Scalar>& stripA, vector<Scalar>& stripB)
+{
+	if (stripA.size() == 0 || stripB.size() == 0) return -1;
+
+	double total = 0;
+
+	for (int i = 0; i < stripA.size(); i++)
+	{
+		int j = (i * stripB.size()) / stripA.size();
+
+		for (int c = 0; c < 3; c++)
+		{
+			total += abs(stripA[i][c] - stripB[j][c]);
+		}
+	}
+
+	return total / (3 * stripA.size());
+}
+
+// How badly two edges fit, lower is better. Each measure is scaled by its
+// match threshold so a plausible match scores under 1 per measure. Colour
+// and seam only count when both pieces have strips.
+double pair_score(double coupling_dist, double average_min_dist, double colour_dist, double seam_dist, PipelineConfig& config)
+{
+	double score = coupling_dist / config.coupling_distance_threshold + average_min_dist / config.avg_min_distance_threshold;
+
+	if (colour_dist >= 0) score += colour_dist / COLOUR_DISTANCE_SCALE;
+	if (seam_dist >= 0) score += seam_dist / SEAM_DISTANCE_SCALE;
+
+	return score;
+}
+
+// Loads a piece and appends its edges, in their own frames, so a pair
+// only costs the scoring itself. The colour descriptor is taken as well
+// when one is asked for.
+bool load_match_piece(string filename, MatchEdges& edges, vector<float>* descriptor)
+{
+	PieceData pd;
+
+	try
+	{
+		pd = PieceData(filename);
+	}
+	catch (runtime_error& e)
+	{
+		cout << "Error on piece '" << filename << "'. " << e.what() << "." << endl;
+		return false;
+	}
+
+	for (int e = 0; e < EDGE_COUNT; e++)
+	{
+		vector<Point> curve;
+		vector<Scalar> colours;
+		SeamModel seam;
+
+		pd.canonicalEdge(e, curve);
+
+		vector<Vec3b>& strip = pd.getColourStrip(e);
+		for (int i = 0; i < strip.size(); i++)
+		{
+			colours.push_back(Scalar(strip[i][0], strip[i][1], strip[i][2]));
+		}
+
+		build_seam_model(pd.getSeamStrip(e), seam);
+
+		edges.types.push_back(pd.getEdgeType(e));
+		edges.curves.push_back(curve);
+		edges.strips.push_back(colours);
+		edges.seams.push_back(seam);
+	}
+
+	if (descriptor != NULL) colour_descriptor(pd, *descriptor);
+
+	return true;
+}
+
+// Loads each piece once, see load_match_piece. With clusters asked for,
+// the pieces are clustered on the descriptors taken while loading.
+bool load_match_edges(vector<string>& filenames, MatchEdges& edges, int cluster_count)
+{
+	vector<vector<float> > descriptors (cluster_count > 0 ? filenames.size() : 0);
+
+	for (int p = 0; p < filenames.size(); p++)
+	{
+		if (!load_match_piece(filenames[p], edges, cluster_count > 0 ? &descriptors[p] : NULL)) return false;
+	}
+
+	cluster_pieces(descriptors, cluster_count, edges.clusters);
+
+	return true;
+}
+
+// The out edge is mated against the in edge with the classifier's
+// alignment, then settled into the best pose near it (see
+// refine_edge_pose) before the shape is measured, so a corner found a
+// little off doesn't count against the pair. field is the in edge's.
+double score_edge_pair(MatchEdges& edges, EdgeField& field, int in_edge, int out_edge, PipelineConfig& config)
+{
+	vector<Point>& curveIn = edges.curves[in_edge];
+	vector<Point> mated;
+	vector<Point> curveOut;
+	mate_edge_points(edges.curves[out_edge], curveIn.back().x, mated);
+
+	EdgePose pose = refine_edge_pose(field, mated);
+	apply_edge_pose(field, pose, mated, curveOut);
+
+	vector<Scalar> stripOut (edges.strips[out_edge].rbegin(), edges.strips[out_edge].rend());
+
+	double coupling_dist = coupling_distance(curveIn, curveOut);
+	double average_min_dist = average_min_dist_measure(curveIn, curveOut);
+	double colour_dist = colour_strip_distance(edges.strips[in_edge], stripOut);
+	double seam_dist = seam_distance(edges.seams[in_edge], edges.seams[out_edge]);
+
+	return pair_score(coupling_dist, average_min_dist, colour_dist, seam_dist, config);
+}
@@ -0,0 +1,48 @@
+#ifndef _MATCH_EDGES_
+#define _MATCH_EDGES_
+
+#include "opencv2/imgproc/imgproc.hpp"
+
+#include <vector>
+#include <string>
+
+#include "PieceData.h"
+#include "PipelineConfig.h"
+#include "EdgeScores.h"
+#include "ColourClusters.h"
+#include "SeamScore.h"
+#include "EdgeAlignment.h"
+
+// Colour distance (mean channel difference) counted as one unit of score
+#define COLOUR_DISTANCE_SCALE 20.0
+
+// Seam distance (per column Mahalanobis gradient distance, about 3 a way
+// for a seam that carries on smoothly) counted as one unit of score
+#define SEAM_DISTANCE_SCALE 6.0
+
+using namespace std;
+using namespace cv;
+
+// Every piece's edges ready for scoring, indexed by edge id: type, points
+// in the edge's own frame, colour strip and seam model. clusters says
+// which pieces' edges are worth comparing.
+struct MatchEdges
+{
+	vector<int> types;
+	vector<vector<Point> > curves;
+	vector<vector<Scalar> > strips;
+	vector<SeamModel> seams;
+	ColourClusters clusters;
+};
+
+void mate_edge_points(vector<Point>& canonical, int length, vector<Point>& out);
+double coupling_distance(vector<Point>& curveA, vector<Point>& curveB);
+double average_min_dist_measure(vector<Point>& curveA, vector<Point>& curveB);
+double colour_strip_distance(vector<Scalar>& stripA, vector<Scalar>& stripB);
+double pair_score(double coupling_dist, double average_min_dist, double colour_dist, double seam_dist, PipelineConfig& config);
+
+bool load_match_piece(string filename, MatchEdges& edges, vector<float>* descriptor);
+bool load_match_edges(vector<string>& filenames, MatchEdges& edges, int cluster_count);
+double score_edge_pair(MatchEdges& edges, EdgeField& field, int in_edge, int out_edge, PipelineConfig& config);
+
+#endif
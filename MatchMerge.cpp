@@ -0,0 +1,113 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#include "CandidateGraph.h"
+
+#define DEFAULT_GRAPH_FILE "graph.txt"
+
+using namespace std;
+
+//--- Forward declarations
+int match_merge(vector<string>& filenames, string graph_filename);
+bool same_pieces(CandidateLists& a, CandidateLists& b);
+//---
+
+// argv should contain the partial candidate files written by every shard
+// of an EdgeMatcher -k -s run, in any order. They are combined into the
+// candidate graph one EdgeMatcher -k run would have written.
+// '-o <file>' names the candidate graph.
+int main(int argc, char* argv[])
+{
+	string graph_filename = DEFAULT_GRAPH_FILE;
+	vector<string> filenames;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+		{
+			graph_filename = string(argv[++i]);
+			continue;
+		}
+
+		filenames.push_back(string(argv[i]));
+	}
+
+	if (filenames.size() == 0)
+	{
+		cout << "Usage: MatchMerge [-o graph] partial..." << endl;
+		return EXIT_FAILURE;
+	}
+
+	return match_merge(filenames, graph_filename);
+}
+
+// Every shard of the run must be there exactly once, all over the same
+// pieces with the same k.
+int match_merge(vector<string>& filenames, string graph_filename)
+{
+	CandidateLists merged;
+	vector<bool> seen;
+
+	for (int i = 0; i < filenames.size(); i++)
+	{
+		CandidateLists lists;
+		MatchShard shard;
+
+		try
+		{
+			read_partial_candidates(filenames[i], lists, shard);
+		}
+		catch (runtime_error& e)
+		{
+			cout << "Error on partial '" << filenames[i] << "'. " << e.what() << "." << endl;
+			return EXIT_FAILURE;
+		}
+
+		if (i == 0)
+		{
+			merged = lists;
+			seen.assign(shard.count, false);
+		}
+		else if (shard.count != seen.size() || lists.top_k != merged.top_k || !same_pieces(lists, merged))
+		{
+			cout << "Error on partial '" << filenames[i] << "'. From a different run to '" << filenames[0] << "'." << endl;
+			return EXIT_FAILURE;
+		}
+		else
+		{
+			merge_candidates(merged, lists);
+		}
+
+		if (shard.index < 0 || shard.index >= seen.size() || seen[shard.index])
+		{
+			cout << "Error on partial '" << filenames[i] << "'. Shard " << shard.index << "/" << shard.count << " given twice or out of range." << endl;
+			return EXIT_FAILURE;
+		}
+
+		seen[shard.index] = true;
+	}
+
+	for (int s = 0; s < seen.size(); s++)
+	{
+		if (seen[s]) continue;
+
+		cout << "Error on shard '" << s << "/" << seen.size() << "'. Missing." << endl;
+		return EXIT_FAILURE;
+	}
+
+	write_candidate_graph(graph_filename, merged);
+
+	cout << "Merged " << seen.size() << " shards over " << merged.names.size() << " pieces" << endl;
+	cout << "Candidate graph written to '" << graph_filename << "'" << endl;
+
+	return EXIT_SUCCESS;
+}
+
+bool same_pieces(CandidateLists& a, CandidateLists& b)
+{
+	return a.names == b.names && a.types == b.types;
+}
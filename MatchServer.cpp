@@ -0,0 +1,420 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "MatchEdges.h"
+
+#define DEFAULT_SOCKET_FILE "match.sock"
+
+// Candidates kept per edge unless -k says otherwise
+#define SERVER_TOP_K 16
+
+// Candidates a best request answers with when it doesn't say
+#define SERVER_BEST_COUNT 5
+
+#define SERVER_BACKLOG 4
+#define SERVER_READ_SIZE 4096
+
+// Longest request line taken, a client sending more is cut off
+#define SERVER_MAX_REQUEST 4096
+
+using namespace std;
+
+// Everything the server keeps loaded: the pieces by name, their edges
+// ready for scoring, a distance field per in edge (see EdgeAlignment)
+// and each edge's best top_k candidates, as a heap with the worst on top.
+struct MatchIndex
+{
+	vector<string> names;
+	map<string, int> pieces;
+	MatchEdges edges;
+	vector<EdgeField> fields;
+	vector<vector<EdgeCandidate> > rows;
+	int top_k;
+	PipelineConfig config;
+};
+
+//--- Forward declarations
+bool add_piece(MatchIndex& index, string filename, long long& pair_count);
+int serve(MatchIndex& index, string socket_filename);
+bool serve_client(MatchIndex& index, int client);
+string answer(MatchIndex& index, string request, bool& stop);
+string answer_best(MatchIndex& index, istringstream& args);
+string answer_score(MatchIndex& index, istringstream& args);
+string answer_add(MatchIndex& index, istringstream& args);
+bool read_edge(MatchIndex& index, istringstream& args, int& edge_id, string& error);
+bool write_all(int fd, string text);
+//---
+
+// Loads the pieces given once, scores them all against each other and
+// then answers requests on a UNIX socket until told to stop, so a client
+// gets answers without paying for process start up and loading.
+// '-u <file>' names the socket, '-k <count>' the candidates kept per edge.
+// Requests are a line each, answers start 'ok' or 'error':
+//	best piece edge [count]		ok n, then n lines: piece edge score
+//	score piece edge piece edge	ok score
+//	add piece			ok piece_number pairs_scored
+//	quit				ends the connection
+//	stop				ends the connection and the server
+int main(int argc, char* argv[])
+{
+	MatchIndex index;
+	index.top_k = SERVER_TOP_K;
+	index.config = default_pipeline_config();
+	index.edges.clusters.count = 0;
+
+	string socket_filename = DEFAULT_SOCKET_FILE;
+	vector<string> filenames;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-u") == 0 && i + 1 < argc)
+		{
+			socket_filename = string(argv[++i]);
+			continue;
+		}
+
+		if (strcmp(argv[i], "-k") == 0 && i + 1 < argc)
+		{
+			index.top_k = max(atoi(argv[++i]), 1);
+			continue;
+		}
+
+		if (strcmp(argv[i], "-p") == 0 && i + 1 < argc)
+		{
+			if (!pipeline_preset(string(argv[++i]), index.config))
+			{
+				cout << "Error on preset '" << argv[i] << "'. Expected one of " << pipeline_preset_names() << "." << endl;
+				return EXIT_FAILURE;
+			}
+			continue;
+		}
+
+		filenames.push_back(string(argv[i]));
+	}
+
+	if (filenames.size() == 0)
+	{
+		cout << "Usage: MatchServer [-p preset] [-k top_k] [-u socket] piece..." << endl;
+		return EXIT_FAILURE;
+	}
+
+	int64 start = getTickCount();
+	long long pair_count = 0;
+
+	for (int i = 0; i < filenames.size(); i++)
+	{
+		if (!add_piece(index, filenames[i], pair_count)) return EXIT_FAILURE;
+	}
+
+	double seconds = (getTickCount() - start) / getTickFrequency();
+
+	cout << "Loaded " << index.names.size() << " pieces and scored " << pair_count << " edge pairs in " << seconds << "s" << endl;
+
+	return serve(index, socket_filename);
+}
+
+// Loads the piece and scores its edges against every edge already loaded,
+// updating the candidates on both sides. Loading the first pieces this
+// way one at a time scores every pair once, the same as EdgeMatcher -a.
+bool add_piece(MatchIndex& index, string filename, long long& pair_count)
+{
+	if (index.pieces.count(filename) > 0)
+	{
+		cout << "Error on piece '" << filename << "'. Already loaded." << endl;
+		return false;
+	}
+
+	int first_new = index.edges.types.size();
+
+	if (!load_match_piece(filename, index.edges, NULL)) return false;
+
+	int edge_count = index.edges.types.size();
+
+	index.pieces[filename] = index.names.size();
+	index.names.push_back(filename);
+	index.fields.resize(edge_count);
+	index.rows.resize(edge_count);
+
+	for (int a = first_new; a < edge_count; a++)
+	{
+		if (index.edges.types[a] == EDGE_TYPE_IN) build_edge_field(index.edges.curves[a], index.fields[a]);
+	}
+
+	for (int a = first_new; a < edge_count; a++)
+	{
+		for (int b = 0; b < first_new; b++)
+		{
+			if (!can_pair(index.edges.types[a], index.edges.types[b])) continue;
+
+			int in_edge = index.edges.types[a] == EDGE_TYPE_IN ? a : b;
+			int out_edge = in_edge == a ? b : a;
+
+			double score = score_edge_pair(index.edges, index.fields[in_edge], in_edge, out_edge, index.config);
+			EdgeCandidate candidateA = { b, score };
+			EdgeCandidate candidateB = { a, score };
+
+			keep_candidate(index.rows[a], candidateA, index.top_k);
+			keep_candidate(index.rows[b], candidateB, index.top_k);
+			pair_count++;
+		}
+	}
+
+	return true;
+}
+
+// One client at a time, which is all a sorting station needs
+int serve(MatchIndex& index, string socket_filename)
+{
+	sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+
+	if (socket_filename.size() >= sizeof(address.sun_path))
+	{
+		cout << "Error on socket '" << socket_filename << "'. Path too long." << endl;
+		return EXIT_FAILURE;
+	}
+
+	strcpy(address.sun_path, socket_filename.c_str());
+
+	// A client going away mid answer shouldn't take the server with it
+	signal(SIGPIPE, SIG_IGN);
+
+	// A socket left by an earlier run is replaced, anything else there is
+	// left alone
+	struct stat info;
+
+	if (lstat(socket_filename.c_str(), &info) == 0)
+	{
+		if (!S_ISSOCK(info.st_mode))
+		{
+			cout << "Error on socket '" << socket_filename << "'. Path exists and isn't a socket." << endl;
+			return EXIT_FAILURE;
+		}
+
+		unlink(socket_filename.c_str());
+	}
+	else if (errno != ENOENT)
+	{
+		cout << "Error on socket '" << socket_filename << "'. " << strerror(errno) << "." << endl;
+		return EXIT_FAILURE;
+	}
+
+	int server = socket(AF_UNIX, SOCK_STREAM, 0);
+
+	if (server < 0 || bind(server, (sockaddr*)&address, sizeof(address)) < 0 || listen(server, SERVER_BACKLOG) < 0)
+	{
+		cout << "Error on socket '" << socket_filename << "'. " << strerror(errno) << "." << endl;
+		if (server >= 0) close(server);
+		return EXIT_FAILURE;
+	}
+
+	cout << "Listening on '" << socket_filename << "'" << endl;
+
+	bool stop = false;
+
+	while (!stop)
+	{
+		int client = accept(server, NULL, NULL);
+
+		if (client < 0)
+		{
+			if (errno == EINTR) continue;
+
+			cout << "Error on socket '" << socket_filename << "'. " << strerror(errno) << "." << endl;
+			break;
+		}
+
+		stop = serve_client(index, client);
+		close(client);
+	}
+
+	close(server);
+	unlink(socket_filename.c_str());
+
+	return stop ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Answers the client's requests until it quits or goes away. True if it
+// asked the server to stop. A request line longer than SERVER_MAX_REQUEST
+// gets an error and the connection is closed, rather than buffering
+// whatever the client sends.
+bool serve_client(MatchIndex& index, int client)
+{
+	string pending;
+	char buffer[SERVER_READ_SIZE];
+
+	while (true)
+	{
+		size_t newline = pending.find('\n');
+
+		if ((newline == string::npos ? pending.size() : newline) > SERVER_MAX_REQUEST)
+		{
+			write_all(client, "error Request too long\n");
+			return false;
+		}
+
+		if (newline == string::npos)
+		{
+			ssize_t count = read(client, buffer, sizeof(buffer));
+
+			if (count < 0 && errno == EINTR) continue;
+			if (count <= 0) return false;
+
+			pending.append(buffer, count);
+			continue;
+		}
+
+		string request = pending.substr(0, newline);
+		pending.erase(0, newline + 1);
+
+		if (request.size() > 0 && request[request.size() - 1] == '\r') request.erase(request.size() - 1);
+		if (request == "quit") return false;
+
+		int64 start = getTickCount();
+		bool stop = false;
+		string reply = answer(index, request, stop);
+
+		cout << request << ": " << 1000.0 * (getTickCount() - start) / getTickFrequency() << "ms" << endl;
+
+		if (!write_all(client, reply) || stop) return stop;
+	}
+}
+
+string answer(MatchIndex& index, string request, bool& stop)
+{
+	istringstream args (request);
+	string command;
+	args >> command;
+
+	if (command == "best") return answer_best(index, args);
+	if (command == "score") return answer_score(index, args);
+	if (command == "add") return answer_add(index, args);
+
+	if (command == "stop")
+	{
+		stop = true;
+		return "ok\n";
+	}
+
+	return "error Unknown request '" + command + "'\n";
+}
+
+// The edge's kept candidates, best first
+string answer_best(MatchIndex& index, istringstream& args)
+{
+	int edge_id;
+	string error;
+	if (!read_edge(index, args, edge_id, error)) return error;
+
+	int count;
+	if (!(args >> count)) count = SERVER_BEST_COUNT;
+
+	vector<EdgeCandidate> best = index.rows[edge_id];
+	sort(best.begin(), best.end(), candidate_better);
+	if (count >= 0 && count < best.size()) best.resize(count);
+
+	ostringstream reply;
+	reply << "ok " << best.size() << "\n";
+
+	for (int i = 0; i < best.size(); i++)
+	{
+		reply << index.names[EDGE_PIECE(best[i].edge)] << " " << EDGE_INDEX(best[i].edge) << " " << best[i].score << "\n";
+	}
+
+	return reply.str();
+}
+
+// Scored afresh rather than looked up, so pairs outside the kept
+// candidates get a score too
+string answer_score(MatchIndex& index, istringstream& args)
+{
+	int edgeA;
+	int edgeB;
+	string error;
+	if (!read_edge(index, args, edgeA, error) || !read_edge(index, args, edgeB, error)) return error;
+
+	if (EDGE_PIECE(edgeA) == EDGE_PIECE(edgeB) || !can_pair(index.edges.types[edgeA], index.edges.types[edgeB]))
+	{
+		return "error Edges can't pair, they need to be an in and an out edge of different pieces\n";
+	}
+
+	int in_edge = index.edges.types[edgeA] == EDGE_TYPE_IN ? edgeA : edgeB;
+	int out_edge = in_edge == edgeA ? edgeB : edgeA;
+
+	ostringstream reply;
+	reply << "ok " << score_edge_pair(index.edges, index.fields[in_edge], in_edge, out_edge, index.config) << "\n";
+
+	return reply.str();
+}
+
+string answer_add(MatchIndex& index, istringstream& args)
+{
+	string filename;
+	if (!(args >> filename)) return "error Expected add piece\n";
+
+	long long pair_count = 0;
+	if (!add_piece(index, filename, pair_count)) return "error Failed to add piece '" + filename + "'\n";
+
+	ostringstream reply;
+	reply << "ok " << index.names.size() - 1 << " " << pair_count << "\n";
+
+	return reply.str();
+}
+
+// A piece name as it was loaded and an edge index
+bool read_edge(MatchIndex& index, istringstream& args, int& edge_id, string& error)
+{
+	string name;
+	int edge;
+
+	if (!(args >> name >> edge))
+	{
+		error = "error Expected piece and edge\n";
+		return false;
+	}
+
+	if (index.pieces.count(name) == 0)
+	{
+		error = "error Unknown piece '" + name + "'\n";
+		return false;
+	}
+
+	if (edge < 0 || edge >= EDGE_COUNT)
+	{
+		error = "error Edge out of range\n";
+		return false;
+	}
+
+	edge_id = EDGE_ID(index.pieces[name], edge);
+	return true;
+}
+
+bool write_all(int fd, string text)
+{
+	size_t written = 0;
+
+	while (written < text.size())
+	{
+		ssize_t count = write(fd, text.data() + written, text.size() - written);
+
+		if (count < 0 && errno == EINTR) continue;
+		if (count <= 0) return false;
+
+		written += count;
+	}
+
+	return true;
+}
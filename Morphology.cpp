@@ -0,0 +1,60 @@
+#include "Morphology.h"
+
+// Opens a binary (0/255) mask with a circular element of the given radius
+// using whichever method is requested.
+void binary_open(Mat& src, Mat& dst, int radius, int method)
+{
+	if (method == MORPH_OPEN_METHOD_DISTANCE)
+	{
+		binary_open_distance(src, dst, radius);
+		return ;
+	}
+
+	binary_open_standard(src, dst, radius);
+}
+
+// Reference implementation, a plain morphologyEx with an ellipse element.
+// Cost grows with the area of the element so gets slow for big radii.
+void binary_open_standard(Mat& src, Mat& dst, int radius)
+{
+	Mat element = getStructuringElement(MORPH_ELLIPSE, Size(2*radius+1, 2*radius+1), Point(radius, radius));
+	binary_open_standard(src, dst, element);
+}
+
+void binary_open_standard(Mat& src, Mat& dst, Mat& element)
+{
+	morphologyEx(src, dst, MORPH_OPEN, element);
+}
+
+// Opening done with two euclidean distance transforms instead of sliding
+// the element around. A pixel survives erosion if the nearest background
+// pixel is out of reach of the element, and survives the following dilation
+// if it is within reach of an eroded pixel. Cost is linear in the image size
+// whatever the radius.
+//
+// The ellipse element rounds its row widths, so it reaches roughly half a
+// pixel past the true radius. Using the same reach keeps the two methods
+// within a pixel of each other along the mask boundary.
+void binary_open_distance(Mat& src, Mat& dst, int radius)
+{
+	Mat distance;
+	Mat eroded;
+
+	binary_open_distance(src, dst, radius, distance, eroded);
+}
+
+// As above but with caller supplied scratch buffers so they can be reused.
+void binary_open_distance(Mat& src, Mat& dst, int radius, Mat& distance, Mat& eroded)
+{
+	double reach = radius + 0.5;
+
+	distanceTransform(src, distance, CV_DIST_L2, CV_DIST_MASK_PRECISE);
+	threshold(distance, eroded, reach, 255, THRESH_BINARY);
+	eroded.convertTo(eroded, CV_8U);
+
+	// Distance to the nearest eroded pixel
+	bitwise_not(eroded, eroded);
+	distanceTransform(eroded, distance, CV_DIST_L2, CV_DIST_MASK_PRECISE);
+	threshold(distance, dst, reach, 255, THRESH_BINARY_INV);
+	dst.convertTo(dst, CV_8U);
+}
@@ -0,0 +1,18 @@
+#ifndef _MORPHOLOGY_
+#define _MORPHOLOGY_
+
+#include "opencv2/imgproc/imgproc.hpp"
+
+#define MORPH_OPEN_METHOD_STANDARD 0
+#define MORPH_OPEN_METHOD_DISTANCE 1
+
+using namespace std;
+using namespace cv;
+
+void binary_open(Mat& src, Mat& dst, int radius, int method);
+void binary_open_standard(Mat& src, Mat& dst, int radius);
+void binary_open_standard(Mat& src, Mat& dst, Mat& element);
+void binary_open_distance(Mat& src, Mat& dst, int radius);
+void binary_open_distance(Mat& src, Mat& dst, int radius, Mat& distance, Mat& eroded);
+
+#endif
@@ -0,0 +1,255 @@
+#include "OccupancyGrid.h"
+
+#include "opencv2/imgproc/imgproc.hpp"
+
+#include <cmath>
+#include <climits>
+
+//--- Forward declarations
+uint64_t span_bits(int first, int last);
+//---
+
+OccupancyGrid::OccupancyGrid(int cols, int rows) :
+	m_cols(cols), m_rows(rows), m_words((cols + OCCUPANCY_WORD_BITS - 1) / OCCUPANCY_WORD_BITS),
+	m_bits(m_words * rows, 0)
+{
+}
+
+// How many cells the mask would cover that are already filled, with its
+// anchor at cell (x, y). Each mask word lands across at most two grid
+// words so the test is two ANDs and popcounts per word.
+int OccupancyGrid::overlap(PieceMask& mask, int x, int y)
+{
+	int origin_x = x - mask.anchor.x;
+	int origin_y = y - mask.anchor.y;
+	int count = 0;
+
+	for (int r = 0; r < mask.rows; r++)
+	{
+		int gy = origin_y + r;
+		if (gy < 0 || gy >= m_rows) continue;
+
+		uint64_t* grid_row = &m_bits[gy * m_words];
+		uint64_t* mask_row = &mask.bits[r * mask.words];
+
+		for (int i = mask.rowFirst[r]; i <= mask.rowLast[r]; i++)
+		{
+			int col = origin_x + i * OCCUPANCY_WORD_BITS;
+			int word = (int)floor(col / (double)OCCUPANCY_WORD_BITS);
+			int shift = col - word * OCCUPANCY_WORD_BITS;
+
+			if (word >= 0 && word < m_words)
+			{
+				count += __builtin_popcountll(grid_row[word] & (mask_row[i] << shift));
+			}
+
+			if (shift > 0 && word + 1 >= 0 && word + 1 < m_words)
+			{
+				count += __builtin_popcountll(grid_row[word + 1] & (mask_row[i] >> (OCCUPANCY_WORD_BITS - shift)));
+			}
+		}
+	}
+
+	return count;
+}
+
+void OccupancyGrid::place(PieceMask& mask, int x, int y)
+{
+	apply(mask, x, y, true);
+}
+
+void OccupancyGrid::remove(PieceMask& mask, int x, int y)
+{
+	apply(mask, x, y, false);
+}
+
+// Sets or clears the mask's cells, anything off the grid is dropped.
+void OccupancyGrid::apply(PieceMask& mask, int x, int y, bool set)
+{
+	int origin_x = x - mask.anchor.x;
+	int origin_y = y - mask.anchor.y;
+	uint64_t last_word = span_bits(0, (m_cols - 1) % OCCUPANCY_WORD_BITS);
+
+	for (int r = 0; r < mask.rows; r++)
+	{
+		int gy = origin_y + r;
+		if (gy < 0 || gy >= m_rows) continue;
+
+		uint64_t* grid_row = &m_bits[gy * m_words];
+		uint64_t* mask_row = &mask.bits[r * mask.words];
+
+		for (int i = mask.rowFirst[r]; i <= mask.rowLast[r]; i++)
+		{
+			int col = origin_x + i * OCCUPANCY_WORD_BITS;
+			int word = (int)floor(col / (double)OCCUPANCY_WORD_BITS);
+			int shift = col - word * OCCUPANCY_WORD_BITS;
+
+			uint64_t parts[2] = { mask_row[i] << shift, shift > 0 ? mask_row[i] >> (OCCUPANCY_WORD_BITS - shift) : 0 };
+
+			for (int p = 0; p < 2; p++)
+			{
+				int w = word + p;
+				if (w < 0 || w >= m_words) continue;
+
+				uint64_t bits = (w == m_words - 1) ? parts[p] & last_word : parts[p];
+
+				if (set) grid_row[w] |= bits;
+				else grid_row[w] &= ~bits;
+			}
+		}
+	}
+}
+
+// Filled cells inside the region, only the words the region spans are
+// looked at.
+int OccupancyGrid::filled(Rect region)
+{
+	int x0 = max(region.x, 0);
+	int y0 = max(region.y, 0);
+	int x1 = min(region.x + region.width, m_cols);
+	int y1 = min(region.y + region.height, m_rows);
+
+	if (x0 >= x1 || y0 >= y1) return 0;
+
+	int first_word = x0 / OCCUPANCY_WORD_BITS;
+	int last_word = (x1 - 1) / OCCUPANCY_WORD_BITS;
+	int count = 0;
+
+	for (int y = y0; y < y1; y++)
+	{
+		uint64_t* grid_row = &m_bits[y * m_words];
+
+		for (int w = first_word; w <= last_word; w++)
+		{
+			int first = (w == first_word) ? x0 % OCCUPANCY_WORD_BITS : 0;
+			int last = (w == last_word) ? (x1 - 1) % OCCUPANCY_WORD_BITS : OCCUPANCY_WORD_BITS - 1;
+
+			count += __builtin_popcountll(grid_row[w] & span_bits(first, last));
+		}
+	}
+
+	return count;
+}
+
+// Empty cells inside the region, cells off the grid are empty.
+int OccupancyGrid::gaps(Rect region)
+{
+	return region.width * region.height - filled(region);
+}
+
+int OccupancyGrid::cols()
+{
+	return m_cols;
+}
+
+int OccupancyGrid::rows()
+{
+	return m_rows;
+}
+
+// The bits first to last inclusive of a word.
+uint64_t span_bits(int first, int last)
+{
+	uint64_t upto_last = (last == OCCUPANCY_WORD_BITS - 1) ? ~(uint64_t)0 : ((uint64_t)1 << (last + 1)) - 1;
+
+	return upto_last & ~(((uint64_t)1 << first) - 1);
+}
+
+// Rasterises the piece once for each quarter turn, masks[r] being the
+// piece turned r quarters anticlockwise the same as Placement rotation.
+// The piece is first squared up so its top edge's corners are level, then
+// the outline is turned about the centre of its corners and filled at
+// cell_size pixels per cell. The fill is eroded by a cell so pieces that
+// meet along an edge don't overlap on the cells the edge runs through.
+void build_piece_masks(PieceData& piece, double cell_size, PieceMask masks[EDGE_COUNT])
+{
+	vector<Point> outline = piece.edge();
+
+	Point top_left = piece.getTopLeftCorner();
+	Point top_right = piece.getTopRightCorner();
+	Point bot_left = piece.getBotLeftCorner();
+	Point bot_right = piece.getBotRightCorner();
+
+	double centre_x = (top_left.x + top_right.x + bot_left.x + bot_right.x) / 4.0;
+	double centre_y = (top_left.y + top_right.y + bot_left.y + bot_right.y) / 4.0;
+
+	double angle = atan2((double)(top_right.y - top_left.y), (double)(top_right.x - top_left.x));
+	double cos_a = cos(angle);
+	double sin_a = sin(angle);
+
+	Mat kernel = getStructuringElement(MORPH_RECT, Size(3, 3));
+
+	for (int r = 0; r < EDGE_COUNT; r++)
+	{
+		vector<vector<Point> > polygon (1);
+		Point low (INT_MAX, INT_MAX);
+		Point high (INT_MIN, INT_MIN);
+
+		for (int i = 0; i < outline.size(); i++)
+		{
+			double dx = outline[i].x - centre_x;
+			double dy = outline[i].y - centre_y;
+
+			double x = dx * cos_a + dy * sin_a;
+			double y = -dx * sin_a + dy * cos_a;
+
+			for (int q = 0; q < r; q++)
+			{
+				double turned = y;
+				y = -x;
+				x = turned;
+			}
+
+			Point cell (cvRound(x / cell_size), cvRound(y / cell_size));
+			polygon[0].push_back(cell);
+
+			low = Point(min(low.x, cell.x), min(low.y, cell.y));
+			high = Point(max(high.x, cell.x), max(high.y, cell.y));
+		}
+
+		PieceMask& mask = masks[r];
+		mask.cols = high.x - low.x + 1;
+		mask.rows = high.y - low.y + 1;
+		mask.words = (mask.cols + OCCUPANCY_WORD_BITS - 1) / OCCUPANCY_WORD_BITS;
+		mask.anchor = Point(-low.x, -low.y);
+		mask.area = 0;
+		mask.bits.assign(mask.words * mask.rows, 0);
+		mask.rowFirst.assign(mask.rows, mask.words);
+		mask.rowLast.assign(mask.rows, -1);
+
+		for (int i = 0; i < polygon[0].size(); i++) polygon[0][i] -= low;
+
+		Mat fill = Mat::zeros(mask.rows, mask.cols, CV_8UC1);
+		fillPoly(fill, polygon, Scalar(1));
+		erode(fill, fill, kernel);
+
+		for (int y = 0; y < mask.rows; y++)
+		{
+			for (int x = 0; x < mask.cols; x++)
+			{
+				if (fill.at<uchar>(y, x) == 0) continue;
+
+				int word = x / OCCUPANCY_WORD_BITS;
+				mask.bits[y * mask.words + word] |= (uint64_t)1 << (x % OCCUPANCY_WORD_BITS);
+				mask.rowFirst[y] = min(mask.rowFirst[y], word);
+				mask.rowLast[y] = max(mask.rowLast[y], word);
+				mask.area++;
+			}
+		}
+	}
+}
+
+// The mean length of the piece's sides, corner to corner.
+double piece_side_length(PieceData& piece)
+{
+	Point corners[4] = { piece.getTopRightCorner(), piece.getTopLeftCorner(), piece.getBotLeftCorner(), piece.getBotRightCorner() };
+	double total = 0;
+
+	for (int i = 0; i < 4; i++)
+	{
+		Point side = corners[(i + 1) % 4] - corners[i];
+		total += sqrt((double)(side.x * side.x + side.y * side.y));
+	}
+
+	return total / 4;
+}
@@ -0,0 +1,63 @@
+#ifndef _OCCUPANCY_GRID_
+#define _OCCUPANCY_GRID_
+
+#include "opencv2/core/core.hpp"
+
+#include <vector>
+#include <cstdint>
+
+#include "PieceData.h"
+
+#define OCCUPANCY_WORD_BITS 64
+
+using namespace std;
+using namespace cv;
+
+// A piece's outline rasterised to coarse cells, one bit per cell packed
+// into 64 bit words a row at a time. anchor is the cell holding the
+// centre of the piece's corners. Each row keeps the span of words that
+// have any bits so empty words at the row ends are skipped.
+struct PieceMask
+{
+	int cols;
+	int rows;
+	int words;
+	int area;
+	Point anchor;
+	vector<uint64_t> bits;
+	vector<int> rowFirst;
+	vector<int> rowLast;
+};
+
+// Which cells of the assembled puzzle are covered. Pieces go in by their
+// masks with the anchor at a cell, so overlap and gap tests are word ANDs
+// and popcounts rather than polygon intersection. Cells outside the grid
+// count as empty.
+class OccupancyGrid
+{
+	private:
+		int m_cols;
+		int m_rows;
+		int m_words;
+		vector<uint64_t> m_bits;
+
+		void apply(PieceMask& mask, int x, int y, bool set);
+
+	public:
+		OccupancyGrid(int cols, int rows);
+
+		int overlap(PieceMask& mask, int x, int y);
+		void place(PieceMask& mask, int x, int y);
+		void remove(PieceMask& mask, int x, int y);
+
+		int filled(Rect region);
+		int gaps(Rect region);
+
+		int cols();
+		int rows();
+};
+
+void build_piece_masks(PieceData& piece, double cell_size, PieceMask masks[EDGE_COUNT]);
+double piece_side_length(PieceData& piece);
+
+#endif
@@ -0,0 +1,202 @@
+#include "PhotoStream.h"
+
+#include <iostream>
+#include <algorithm>
+#include <vector>
+#include <chrono>
+#include <dirent.h>
+#include <sys/stat.h>
+
+bool is_photo_filename(string name)
+{
+	if (name.size() == 0 || name[0] == '.') return false;
+
+	size_t dot = name.rfind('.');
+	if (dot == string::npos) return false;
+
+	string ext = name.substr(dot);
+	transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+
+	return ext == ".jpg" || ext == ".jpeg" || ext == ".png" || ext == ".bmp";
+}
+
+PhotoStream::PhotoStream(string source)
+{
+	m_source = source;
+	m_finished = false;
+	m_failed = false;
+}
+
+PhotoStream::~PhotoStream()
+{
+	if (m_decoder.joinable()) m_decoder.join();
+}
+
+// False, without starting, if the watched folder can't be opened.
+bool PhotoStream::start()
+{
+	if (m_source != PHOTO_STREAM_STDIN)
+	{
+		DIR* dir = opendir(m_source.c_str());
+
+		if (dir == NULL)
+		{
+			cout << "Error on folder '" << m_source << "'. Could not open folder." << endl;
+			return false;
+		}
+
+		closedir(dir);
+	}
+
+	m_decoder = thread(&PhotoStream::decodeLoop, this);
+	return true;
+}
+
+// Blocks until the next decoded photo is ready. Returns false once
+// the source has run out (stdin closed) or the watched folder can no
+// longer be read, see failed().
+bool PhotoStream::next(DecodedPhoto& photo)
+{
+	unique_lock<mutex> lock (m_lock);
+
+	while (m_photos.empty() && !m_finished)
+	{
+		m_changed.wait(lock);
+	}
+
+	if (m_photos.empty()) return false;
+
+	photo = m_photos.front();
+	m_photos.pop_front();
+	m_changed.notify_all();
+
+	return true;
+}
+
+// Whether the stream ended because the watched folder went away
+bool PhotoStream::failed()
+{
+	lock_guard<mutex> lock (m_lock);
+	return m_failed;
+}
+
+void PhotoStream::decodeLoop()
+{
+	string path;
+	int64 found_tick;
+
+	while (nextPath(path, found_tick))
+	{
+		DecodedPhoto photo;
+		photo.filename = path;
+		photo.found_tick = found_tick;
+
+		int64 decode_start = getTickCount();
+		photo.image = imread(path);
+		photo.decode_ms = (getTickCount() - decode_start) * 1000.0 / getTickFrequency();
+
+		unique_lock<mutex> lock (m_lock);
+
+		while (m_photos.size() >= PHOTO_STREAM_BUFFERED)
+		{
+			m_changed.wait(lock);
+		}
+
+		m_photos.push_back(photo);
+		m_changed.notify_all();
+	}
+
+	lock_guard<mutex> lock (m_lock);
+	m_finished = true;
+	m_changed.notify_all();
+}
+
+bool PhotoStream::nextPath(string& path, int64& found_tick)
+{
+	if (m_source == PHOTO_STREAM_STDIN)
+	{
+		while (getline(cin, path))
+		{
+			found_tick = getTickCount();
+			if (path.size() > 0) return true;
+		}
+
+		return false;
+	}
+
+	while (m_readyPaths.empty())
+	{
+		if (!pollDirectory())
+		{
+			lock_guard<mutex> lock (m_lock);
+			m_failed = true;
+			return false;
+		}
+
+		if (m_readyPaths.empty())
+		{
+			this_thread::sleep_for(chrono::milliseconds(PHOTO_STREAM_POLL_MS));
+		}
+	}
+
+	path = m_readyPaths.front().first;
+	found_tick = m_readyPaths.front().second;
+	m_readyPaths.pop_front();
+
+	return true;
+}
+
+// Looks for new photos in the watched folder. The rig may still be
+// writing a file when it first shows up, so a file is only taken once
+// its size has stayed the same between two polls. It counts as found
+// from the first poll that saw it. False if the folder can't be opened.
+bool PhotoStream::pollDirectory()
+{
+	DIR* dir = opendir(m_source.c_str());
+
+	if (dir == NULL)
+	{
+		cout << "Error on folder '" << m_source << "'. Could not open folder." << endl;
+		return false;
+	}
+
+	vector<pair<string, int64> > ready;
+	struct dirent* entry;
+	int64 poll_tick = getTickCount();
+
+	while ((entry = readdir(dir)) != NULL)
+	{
+		string name = entry->d_name;
+
+		if (!is_photo_filename(name)) continue;
+
+		string path = m_source + "/" + name;
+		if (m_seen.count(path) > 0) continue;
+
+		struct stat info;
+		if (stat(path.c_str(), &info) != 0 || !S_ISREG(info.st_mode)) continue;
+
+		map<string, long>::iterator it = m_pendingSizes.find(path);
+
+		if (it != m_pendingSizes.end() && it->second == info.st_size && info.st_size > 0)
+		{
+			m_pendingSizes.erase(it);
+			m_seen.insert(path);
+			ready.push_back(make_pair(path, m_foundTicks[path]));
+			m_foundTicks.erase(path);
+		}
+		else
+		{
+			m_pendingSizes[path] = info.st_size;
+			if (m_foundTicks.count(path) == 0) m_foundTicks[path] = poll_tick;
+		}
+	}
+
+	closedir(dir);
+
+	// Capture names usually sort in shot order
+	sort(ready.begin(), ready.end());
+	m_readyPaths.insert(m_readyPaths.end(), ready.begin(), ready.end());
+
+	return true;
+}
@@ -0,0 +1,66 @@
+#ifndef _PHOTO_STREAM_
+#define _PHOTO_STREAM_
+
+#include "opencv2/highgui/highgui.hpp"
+
+#include <string>
+#include <set>
+#include <map>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#define PHOTO_STREAM_STDIN "-"
+#define PHOTO_STREAM_POLL_MS 200
+#define PHOTO_STREAM_BUFFERED 1
+
+using namespace std;
+using namespace cv;
+
+// found_tick is when the photo first turned up: read from stdin or, from
+// a watched folder, first seen there (before waiting for it to finish
+// being written)
+struct DecodedPhoto
+{
+	string filename;
+	Mat image;
+	int64 found_tick;
+	double decode_ms;
+};
+
+// Supplies photos as they turn up, either paths read line by line from
+// stdin or new files appearing in a watched capture folder. A background
+// thread decodes the next photo while the caller works on the current
+// one; at most PHOTO_STREAM_BUFFERED decoded photos wait in the queue so
+// memory stays at two photos whatever the backlog.
+class PhotoStream
+{
+	private:
+		string m_source;
+		set<string> m_seen;
+		map<string, long> m_pendingSizes;
+		map<string, int64> m_foundTicks;
+		deque<pair<string, int64> > m_readyPaths;
+
+		thread m_decoder;
+		mutex m_lock;
+		condition_variable m_changed;
+		deque<DecodedPhoto> m_photos;
+		bool m_finished;
+		bool m_failed;
+
+		bool nextPath(string& path, int64& found_tick);
+		bool pollDirectory();
+		void decodeLoop();
+
+	public:
+		PhotoStream(string source);
+		~PhotoStream();
+
+		bool start();
+		bool next(DecodedPhoto& photo);
+		bool failed();
+};
+
+#endif
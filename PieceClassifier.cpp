@@ -9,27 +9,57 @@
 #include <stdlib.h>
 #include <math.h>
 #include <list>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <glob.h>
+#include <dirent.h>
+#include <sys/stat.h>
 
 #include "PieceData.h"
 #include "GeometryHelpers.h"
+#include "CornerFinder.h"
+#include "PipelineConfig.h"
 
-#define EDGE_STRAY_THRESHOLD 5
-#define EDGE_BIAS_THRESHOLD 5 
+#define BENCHMARK_SIMPLIFY_AMOUNTS { 15, 10, 6, 4, 3, 2 }
+#define BENCHMARK_EXHAUSTIVE_MAX_POINTS 150
 
-#define EDGE_SIMPLIFY_AMOUNT 15
-#define RIGHT_ANGLE_DIFF 7.0
-#define RIGHT_ANGLE_MIN 90 - RIGHT_ANGLE_DIFF
-#define RIGHT_ANGLE_MAX 90 + RIGHT_ANGLE_DIFF
-#define NOT_RIGHT_ANGLE(x) (x < RIGHT_ANGLE_MIN || x > RIGHT_ANGLE_MAX)
-#define NOT_NEARLY_RIGHT_ANGLE(x) (x < RIGHT_ANGLE_MIN - RIGHT_ANGLE_DIFF*2.5 || x > RIGHT_ANGLE_MAX + RIGHT_ANGLE_DIFF*2.5)
-//#define NOT_NEARLY_RIGHT_ANGLE(x) false
+#define DEFAULT_SUMMARY_FILE "summary.txt"
+
+// Opposite sides of the corner rectangle shorter than this fraction of
+// each other give no confidence in the corners
+#define CORNER_MIN_SIDE_RATIO 0.5
+
+// What classifying a single piece found, or why it failed
+struct ClassifierResult
+{
+	string filename;
+	bool success;
+	string error;
+	vector<Point> corners;
+	vector<int> edge_types;
+
+	// 0 (a guess) to 1 (certain), the piece's is the lowest of the others
+	double corner_confidence;
+	vector<double> edge_confidences;
+	double confidence;
+
+	// 1 if the cheap pass was confident enough, 2 if the piece needed the
+	// finer second pass
+	int pass;
+};
 
 //--- Forward declarations
 Point origin_point(vector<Point>& edge);
-vector<Point> find_corner_points(vector<Point>& smoothed_edge, Size area);
 vector<int> find_corner_indexs(vector<Point>& edge, vector<Point>& corner_points);
-int classify_edge(PieceData* pd, int edge_index);
-int piece_classifier(string piece_filename, bool debug);
+int classify_edge(PieceData* pd, int edge_index, PipelineConfig& config, double& confidence);
+bool classify_outline(PieceData& pd, int simplify_amount, double right_angle_diff, PipelineConfig& config, ClassifierResult& result);
+double corner_confidence(vector<Point>& corner_points, double right_angle_diff);
+int piece_classifier(string piece_filename, bool debug, PipelineConfig& config);
+ClassifierResult classify_piece(string piece_filename, bool debug, PipelineConfig& config);
+int batch_classifier(vector<string>& inputs, int thread_count, string summary_filename, PipelineConfig& config);
+vector<string> expand_piece_inputs(vector<string>& inputs);
+int benchmark_corner_finders(string piece_filename, PipelineConfig& config);
 
 void drawEdge(Mat display_img, PieceData* pd, int edge_index, Scalar color, int line_width);
 void display(PieceData* piece, string window_name);
@@ -38,21 +68,75 @@ void display(PieceData* piece, string window_name);
 // argv should contain list of filenames for image segments 
 // (either the .edg, .jpg or no extension)
 // and optionally '-v' which will cause debug information to be
-// shown for all images which come after that argument
+// shown for all images which come after that argument.
+// '-b' benchmarks the corner finders on the pieces after it
+// instead of classifying them, with the preset's right angle tolerance
+// and simplify amounts.
+// '-j <threads>' classifies all the pieces across a pool of threads
+// instead of one at a time. In that mode arguments can also be folders
+// or glob patterns and the results go into a single summary file,
+// named with '-o <file>'.
+// '-p <preset>' picks the pipeline preset (default, fast or accurate)
+// for the pieces after it.
 int main(int argc, char* argv[]) 
 {
-	string piece_filename = string(argv[1]);
-
 	bool debug = false;
+	bool benchmark = false;
+	int thread_count = 0;
+	string summary_filename = DEFAULT_SUMMARY_FILE;
+	vector<string> batch_inputs;
+	PipelineConfig config = default_pipeline_config();
+
 	for (int i = 1; i < argc; i++)
 	{
+		if (strcmp(argv[i], "-p") == 0 && i + 1 < argc)
+		{
+			if (!pipeline_preset(string(argv[++i]), config))
+			{
+				cout << "Error on preset '" << argv[i] << "'. Expected one of " << pipeline_preset_names() << "." << endl;
+				return EXIT_FAILURE;
+			}
+
+			continue;
+		}
+
+		if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+		{
+			thread_count = max(atoi(argv[++i]), 1);
+			continue;
+		}
+
+		if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+		{
+			summary_filename = string(argv[++i]);
+			continue;
+		}
+
+		if (thread_count > 0)
+		{
+			batch_inputs.push_back(string(argv[i]));
+			continue;
+		}
+
 		if (strcmp(argv[i], "-v") == 0)
 		{
 			debug = true;
 			continue;
 		}
 
-		int success = piece_classifier(string(argv[i]), debug);
+		if (strcmp(argv[i], "-b") == 0)
+		{
+			benchmark = true;
+			continue;
+		}
+
+		if (benchmark)
+		{
+			benchmark_corner_finders(string(argv[i]), config);
+			continue;
+		}
+
+		int success = piece_classifier(string(argv[i]), debug, config);
 
 		if (success == EXIT_FAILURE) 
 		{
@@ -61,53 +145,322 @@ int main(int argc, char* argv[])
 
 	}
 
+	if (thread_count > 0)
+	{
+		return batch_classifier(batch_inputs, thread_count, summary_filename, config);
+	}
+
 	waitKey();
 
 	return EXIT_SUCCESS;
 }
 
 // The piece classifier.
-int piece_classifier(string piece_filename, bool debug)
+int piece_classifier(string piece_filename, bool debug, PipelineConfig& config)
 {
-	PieceData pd (piece_filename);
+	ClassifierResult result = classify_piece(piece_filename, debug, config);
+
+	if (!result.success)
+	{
+		return EXIT_FAILURE;
+	}
+
+	cout << "Piece '"<< piece_filename << "'\t - Edges: \t";
+	for (int i = 0; i < EDGE_COUNT; i++) 
+	{
+		cout << EDGE_DIR_NAMES[i] << ": " << EDGE_TYPE_NAMES[result.edge_types[i]] << "\t";
+	}
+	cout << "Confidence: " << result.confidence << (result.pass == 2 ? " (second pass)" : "") << endl;
+
+	return EXIT_SUCCESS;
+}
+
+// Finds the corners of a piece, classifies its edges and writes them
+// back to the piece's .edg file. Prints nothing, so (with debug off) it
+// can be run from any thread.
+// Every piece first gets the cheap pass with the preset's simplification.
+// Only if that fails or isn't confident enough is the outline simplified
+// more finely and searched with a looser right angle, which finds more
+// candidate corners, keeping whichever pass was more confident.
+ClassifierResult classify_piece(string piece_filename, bool debug, PipelineConfig& config)
+{
+	ClassifierResult result;
+	result.filename = piece_filename;
+	result.success = false;
+	result.confidence = 0;
+	result.pass = 1;
+
+	// Anything thrown while classifying, OpenCV's errors included, fails
+	// just this piece rather than taking the batch down with it
+	try
+	{
+		PieceData pd (piece_filename);
+
+		// Classifying moves the piece's origin, so the second pass needs
+		// its own copy
+		PieceData refined = pd;
+
+		classify_outline(pd, config.edge_simplify_amount, config.right_angle_diff, config, result);
+
+		if (result.confidence < config.confidence_threshold)
+		{
+			ClassifierResult second = result;
+			second.pass = 2;
+
+			classify_outline(refined, config.fallback_simplify_amount, config.fallback_right_angle_diff, config, second);
+
+			if (second.confidence > result.confidence || !result.success)
+			{
+				result = second;
+				pd = refined;
+			}
+			else
+			{
+				result.pass = 2;
+			}
+		}
+
+		if (!result.success) return result;
+
+		pd.computeEdgeTransforms();
+		pd.computeColourStrips();
+
+		if (debug) display(&pd, piece_filename);
+
+		pd.write(piece_filename);
+
+		return result;
+	}
+	catch (exception& e)
+	{
+		result.success = false;
+		result.error = e.what();
+		return result;
+	}
+}
+
+// Finds the corners and classifies the edges of the piece outline once
+// simplified by simplify_amount, filling in result and its confidences.
+bool classify_outline(PieceData& pd, int simplify_amount, double right_angle_diff, PipelineConfig& config, ClassifierResult& result)
+{
+	result.success = false;
+	result.confidence = 0;
+	result.corners.clear();
+	result.edge_types.clear();
+	result.edge_confidences.clear();
 
 	vector<Point> edge = pd.edge();
 	vector<Point> smoothed_edge (edge.size());
 
-	approxPolyDP(edge, smoothed_edge, EDGE_SIMPLIFY_AMOUNT, true);
+	approxPolyDP(edge, smoothed_edge, simplify_amount, true);
 
-	vector<Point> corner_points = find_corner_points(smoothed_edge, pd.image().size());
-	pd.setOrigin(origin_point(corner_points));
+	vector<Point> corner_points = find_corner_points(smoothed_edge, pd.image().size(), right_angle_diff);
 
 	if (corner_points.size() == 0)
 	{
-		return EXIT_FAILURE;
+		result.error = "No corners found";
+		return false;
 	}
 
+	// Judged against the preset's right angle whichever pass this is, so
+	// the looser second pass can't look more confident for the same corners
+	result.corner_confidence = corner_confidence(corner_points, config.right_angle_diff);
+	result.confidence = result.corner_confidence;
+
+	pd.setOrigin(origin_point(corner_points));
+
 	vector<int> corner_indexs = find_corner_indexs(edge, corner_points);
 
 	pd.setCornerIndexs(corner_indexs);
 
-	cout << "Piece '"<< piece_filename << "'\t - Edges: \t";
 	for (int i = 0; i < EDGE_COUNT; i++) 
 	{
-		int type = classify_edge(&pd, i);
+		double confidence;
+		int type = classify_edge(&pd, i, config, confidence);
 
 		pd.setEdgeType(i, type);
+		result.edge_types.push_back(type);
+		result.edge_confidences.push_back(confidence);
+		result.corners.push_back(edge[corner_indexs[i]]);
 
-		cout << EDGE_DIR_NAMES[i] << ": " << EDGE_TYPE_NAMES[type] << "\t";
+		result.confidence = min(result.confidence, confidence);
 	}
-	cout << endl;
 
-	if (debug) display(&pd, piece_filename);
+	result.error = "";
+	result.success = true;
+	return true;
+}
+
+// How much the corners look like the corners of a piece: the worst of
+// how close each angle of the corner rectangle is to 90 degrees (against
+// the allowed difference) and how close opposite sides are in length.
+// Corners come from find_corner_points, which goes round them in the
+// order 0, 2, 3, 1.
+double corner_confidence(vector<Point>& corner_points, double right_angle_diff)
+{
+	int order[4] = { 0, 2, 3, 1 };
+	double worst_angle = 0;
+	double sides[4];
 
-	pd.write(piece_filename);
+	for (int c = 0; c < 4; c++)
+	{
+		Point prev = corner_points[order[(c + 3) % 4]];
+		Point middle = corner_points[order[c]];
+		Point next = corner_points[order[(c + 1) % 4]];
 
-	return EXIT_SUCCESS;
+		worst_angle = max(worst_angle, fabs(interior_angle_d(middle, prev, next) - 90));
+		sides[c] = euclid_distance(middle, next);
+	}
+
+	double angle_confidence = 1 - worst_angle / right_angle_diff;
+
+	double side_ratio = min(min(sides[0], sides[2]) / max(sides[0], sides[2]),
+	                        min(sides[1], sides[3]) / max(sides[1], sides[3]));
+	double side_confidence = (side_ratio - CORNER_MIN_SIDE_RATIO) / (1 - CORNER_MIN_SIDE_RATIO);
+
+	return max(0.0, min(angle_confidence, side_confidence));
+}
+
+// Classifies every piece in inputs over a pool of threads, each thread
+// taking the next unclassified piece until none are left. Writes one
+// line per piece to the summary file (in input order) with its corners
+// (image coordinates, in corner order), edge types, confidence and which
+// pass classified it, or why it failed.
+int batch_classifier(vector<string>& inputs, int thread_count, string summary_filename, PipelineConfig& config)
+{
+	vector<string> pieces = expand_piece_inputs(inputs);
+	vector<ClassifierResult> results (pieces.size());
+	atomic<int> next_piece (0);
+
+	int64 start = getTickCount();
+
+	vector<thread> workers;
+	for (int t = 0; t < thread_count; t++)
+	{
+		workers.push_back(thread([&]()
+		{
+			int i;
+			while ((i = next_piece++) < (int)pieces.size())
+			{
+				results[i] = classify_piece(pieces[i], false, config);
+			}
+		}));
+	}
+
+	for (int t = 0; t < workers.size(); t++)
+	{
+		workers[t].join();
+	}
+
+	double seconds = (getTickCount() - start) / getTickFrequency();
+
+	fstream fs (summary_filename.c_str(), fstream::out);
+	int failures = 0;
+	int second_passes = 0;
+
+	for (int i = 0; i < results.size(); i++)
+	{
+		ClassifierResult& result = results[i];
+
+		if (result.pass == 2) second_passes++;
+
+		fs << result.filename;
+
+		if (!result.success)
+		{
+			fs << "\tFAIL\t" << result.error << endl;
+			failures++;
+			continue;
+		}
+
+		fs << "\tOK";
+		for (int c = 0; c < result.corners.size(); c++)
+		{
+			fs << "\t" << result.corners[c].x << "," << result.corners[c].y;
+		}
+
+		for (int e = 0; e < result.edge_types.size(); e++)
+		{
+			string name = EDGE_TYPE_NAMES[result.edge_types[e]];
+			fs << "\t" << name.substr(0, name.find(' '));
+		}
+
+		fs << "\t" << result.confidence << "\t" << result.pass;
+		fs << endl;
+	}
+
+	fs.close();
+
+	cout << "Classified " << pieces.size() << " pieces (" << failures << " failed) on " << thread_count << " threads";
+	cout << " in " << seconds << "s, " << (seconds > 0 ? pieces.size() / seconds : 0) << " pieces/s" << endl;
+	cout << "First pass: " << pieces.size() - second_passes << " pieces, second pass: " << second_passes;
+	cout << " (" << (pieces.size() > 0 ? second_passes * 100.0 / pieces.size() : 0) << "%)" << endl;
+	cout << "Summary written to '" << summary_filename << "'" << endl;
+
+	return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Turns the batch arguments into a list of pieces. Folders give every
+// .edg file in them, glob patterns every match, anything else is taken
+// as a piece name.
+vector<string> expand_piece_inputs(vector<string>& inputs)
+{
+	vector<string> pieces;
+
+	for (int i = 0; i < inputs.size(); i++)
+	{
+		string input = inputs[i];
+		struct stat info;
+
+		if (stat(input.c_str(), &info) == 0 && S_ISDIR(info.st_mode))
+		{
+			vector<string> found;
+			DIR* dir = opendir(input.c_str());
+			struct dirent* entry;
+
+			while (dir != NULL && (entry = readdir(dir)) != NULL)
+			{
+				string name = entry->d_name;
+
+				if (name.size() > 4 && name.substr(name.size() - 4) == ".edg")
+				{
+					found.push_back(input + "/" + name);
+				}
+			}
+
+			if (dir != NULL) closedir(dir);
+
+			sort(found.begin(), found.end());
+			pieces.insert(pieces.end(), found.begin(), found.end());
+		}
+		else if (input.find_first_of("*?[") != string::npos)
+		{
+			glob_t matches;
+
+			if (glob(input.c_str(), 0, NULL, &matches) == 0)
+			{
+				for (int m = 0; m < matches.gl_pathc; m++)
+				{
+					pieces.push_back(string(matches.gl_pathv[m]));
+				}
+			}
+
+			globfree(&matches);
+		}
+		else
+		{
+			pieces.push_back(input);
+		}
+	}
+
+	return pieces;
 }
 
 // Classifies an edge as one of {EDGE_TYPE_FLAT, EDGE_TYPE_IN, EDGE_TYPE_OUT}. 
-int classify_edge(PieceData* pd, int edge_index)
+// confidence is set to how clear cut the decision was: for a flat edge
+// how far the bias is under the threshold, otherwise how far it is over
+// and how many of the straying points agree on the side.
+int classify_edge(PieceData* pd, int edge_index, PipelineConfig& config, double& confidence)
 {
 	ptIter edge_begin = pd->getEdgeBegin(edge_index);
 	ptIter edge_end = pd->getEdgeEnd(edge_index);
@@ -118,20 +471,25 @@ int classify_edge(PieceData* pd, int edge_index)
 	Point second_corner = *(edge_end - 1);
 	
 	int origin_side_of_line = side_of_line(Point(0, 0), first_corner, second_corner);
-	double origin_dist_to_line = distance_from_line(Point(0, 0), first_corner, second_corner);
+	double origin_dist_to_line_sq = squared_distance_from_line(Point(0, 0), first_corner, second_corner);
+
+	// Points further than this (squared) from the line count as straying
+	double stray_dist_sq = origin_dist_to_line_sq / (config.edge_stray_threshold * config.edge_stray_threshold);
 
 	// Keeps track of direction lumps on the line tend to be pointing
 	int edge_bias = 0;
+	int stray_count = 0;
 
 	ptIter iter = edge_begin;
 	while(iter != edge_end)
 	{
-		if (distance_from_line(*iter, first_corner, second_corner) > origin_dist_to_line / EDGE_STRAY_THRESHOLD)
+		if (squared_distance_from_line(*iter, first_corner, second_corner) > stray_dist_sq)
 		{
 			//Either 1 or -1 depending on which side of line it falls on
 			int side = side_of_line(*iter, first_corner, second_corner);			
 		
 			edge_bias += side;			
+			stray_count++;
 		}
 
 		iter ++;
@@ -141,10 +499,19 @@ int classify_edge(PieceData* pd, int edge_index)
 		}
 	}
 
+	int bias_threshold = config.edge_bias_threshold;
+
 	// If there are few points straying from the optimal line
 	// then the edge is probably flat
-	if (abs(edge_bias) < EDGE_BIAS_THRESHOLD)
+	if (abs(edge_bias) < bias_threshold)
+	{
+		confidence = 1 - (double)abs(edge_bias) / bias_threshold;
 		return EDGE_TYPE_FLAT;
+	}
+
+	double margin = (double)(abs(edge_bias) - bias_threshold + 1) / bias_threshold;
+	double agreement = (double)abs(edge_bias) / stray_count;
+	confidence = min(1.0, min(margin, agreement));
 
 	// otherwise check if the majority of points straying from
 	// the line are on the origin side of the line or not.
@@ -154,89 +521,62 @@ int classify_edge(PieceData* pd, int edge_index)
 		return EDGE_TYPE_OUT;
 }
 
-// Attempts to find the corner points of the piece contour by finding the four points
-// which create the (roughly) rectanglaur quadralateral with the largest area.
-vector<Point> find_corner_points(vector<Point>& smoothed_edge, Size area_size)
+// Runs the fast and exhaustive corner finders over the piece outline
+// simplified by different amounts (so with different point counts),
+// printing how long each took and whether they agree.
+int benchmark_corner_finders(string piece_filename, PipelineConfig& config)
 {
-	double greatest_area = 0;
-	vector<Point> corner_points (4);
+	PieceData pd (piece_filename);
+
+	vector<Point> edge = pd.edge();
+	Size area_size = pd.image().size();
 
-	Point estimated_origin (area_size.width / 2, area_size.height / 2);
+	// The preset's own simplify amounts first, then the fixed list
+	int fixed_amounts[] = BENCHMARK_SIMPLIFY_AMOUNTS;
+	vector<int> amounts;
+	amounts.push_back(config.edge_simplify_amount);
+	if (config.fallback_simplify_amount != amounts[0]) amounts.push_back(config.fallback_simplify_amount);
 
-	for (int i = 0; i < smoothed_edge.size(); i++) 
+	for (int i = 0; i < sizeof(fixed_amounts) / sizeof(fixed_amounts[0]); i++)
 	{
-		double angle;
-		for (int j = 0; j < smoothed_edge.size(); j++) 
-		{
-			if (j == i) continue;
+		if (find(amounts.begin(), amounts.end(), fixed_amounts[i]) == amounts.end()) amounts.push_back(fixed_amounts[i]);
+	}
 
-			angle = interior_angle_d(estimated_origin, smoothed_edge[i], smoothed_edge[j]);
-			if (NOT_NEARLY_RIGHT_ANGLE(angle)) continue;
+	int amount_count = amounts.size();
+	int mismatches = 0;
 
-			for (int k = 0; k < smoothed_edge.size(); k++) 
-			{
-				if (k == j || k == i) continue;
-				
-				angle = interior_angle_d(smoothed_edge[i], smoothed_edge[j], smoothed_edge[k]);
-				if (NOT_RIGHT_ANGLE(angle)) continue;
+	cout << "Piece '" << piece_filename << "', preset " << config.name << endl;
+	cout << "simplify\tpoints\tfast ms\t\texhaustive ms\tresult" << endl;
 
-				angle = interior_angle_d(estimated_origin, smoothed_edge[i], smoothed_edge[k]);
-				if (NOT_NEARLY_RIGHT_ANGLE(angle)) continue;
+	for (int i = 0; i < amount_count; i++)
+	{
+		vector<Point> smoothed_edge;
+		approxPolyDP(edge, smoothed_edge, amounts[i], true);
 
-				for (int l = 0; l < smoothed_edge.size(); l++) 
-				{
-					if (l == k || l == j || l == i) continue;
-
-					angle = interior_angle_d(smoothed_edge[k], smoothed_edge[i], smoothed_edge[l]);
-					if (NOT_RIGHT_ANGLE(angle)) continue;
-					
-					angle = interior_angle_d(smoothed_edge[l], smoothed_edge[k], smoothed_edge[j]);
-					if (NOT_RIGHT_ANGLE(angle)) continue;
-
-					angle = interior_angle_d(estimated_origin, smoothed_edge[k], smoothed_edge[l]);
-					if (NOT_NEARLY_RIGHT_ANGLE(angle)) continue;
-
-					angle = interior_angle_d(estimated_origin, smoothed_edge[j], smoothed_edge[l]);
-					if (NOT_NEARLY_RIGHT_ANGLE(angle)) continue;
-					
-					double area = area_of_rectangle(smoothed_edge[l], smoothed_edge[k], smoothed_edge[j]);
-					//TODO: use area of intersection
-					if (area > greatest_area) 
-					{
-						greatest_area = area;
-						corner_points[0] = smoothed_edge[i];
-						corner_points[1] = smoothed_edge[j];
-						corner_points[2] = smoothed_edge[k];
-						corner_points[3] = smoothed_edge[l];
-
-					}
-				}
-			}
+		int64 start = getTickCount();
+		vector<Point> fast_corners = find_corner_points(smoothed_edge, area_size, config.right_angle_diff);
+		double fast_ms = (getTickCount() - start) * 1000.0 / getTickFrequency();
+
+		cout << amounts[i] << "\t\t" << smoothed_edge.size() << "\t" << fast_ms << "\t\t";
+
+		if (smoothed_edge.size() > BENCHMARK_EXHAUSTIVE_MAX_POINTS)
+		{
+			cout << "-\t\tskipped" << endl;
+			continue;
 		}
-	}
 
-	if (greatest_area == 0)
-	{
-		corner_points.clear();
-	}
+		start = getTickCount();
+		vector<Point> exhaustive_corners = find_corner_points_exhaustive(smoothed_edge, area_size, config.right_angle_diff);
+		double exhaustive_ms = (getTickCount() - start) * 1000.0 / getTickFrequency();
 
-	/*
-	cout << corner_points[0] << corner_points[1] << corner_points[2] << corner_points[3] << endl;
-
-	double angle;
-	angle = interior_angle_d(estimated_origin, corner_points[0], corner_points[1]);
-	cout << "i-j " << angle << endl;
-	angle = interior_angle_d(estimated_origin, corner_points[0], corner_points[2]);
-	cout << "i-k " << angle << endl;
-	angle = interior_angle_d(estimated_origin, corner_points[2], corner_points[3]);
-	cout << "k-l " << angle << endl;
-	angle = interior_angle_d(estimated_origin, corner_points[1], corner_points[3]);
-	cout << "j-l " << angle << endl;
-	*/
+		bool same = (fast_corners == exhaustive_corners);
+		if (!same) mismatches++;
 
-	return corner_points;
-}
+		cout << exhaustive_ms << "\t\t" << (same ? "same" : "MISMATCH") << endl;
+	}
 
+	return mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
 
 vector<int> find_corner_indexs(vector<Point>& edge, vector<Point>& corner_points)
 {
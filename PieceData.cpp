@@ -7,23 +7,36 @@ using namespace std;
 const string EDGE_DIR_NAMES[] = { "TOP", "LEFT", "BOT", "RIGHT" };
 const string EDGE_TYPE_NAMES[] = { "FLAT", "IN  ", "OUT "};
 
-PieceData::PieceData(Mat image_data, vector<Point> edge_data) : m_cornerIndexs(4), m_edgeType(4)
+PieceData::PieceData() : m_cornerIndexs(4), m_edgeType(4), m_colourStrips(4), m_seamStrips(4), m_edgeTransforms(4)
+{
+}
+
+PieceData::PieceData(Mat image_data, vector<Point> edge_data) : m_cornerIndexs(4), m_edgeType(4), m_colourStrips(4), m_seamStrips(4), m_edgeTransforms(4)
 {
 	m_imageData = image_data;
 	m_edgeData = edge_data;
 }
 
 
-// Just realised how memory bad this is. TODO: Move masking shit back out of here or something.
-PieceData::PieceData(Mat* src_data, vector<Point> edge_data) : m_cornerIndexs(4), m_edgeType(4)
+PieceData::PieceData(Mat* src_data, vector<Point> edge_data) : PieceData(src_data, edge_data, contour_bounding_rect(edge_data))
+{
+}
+
+// Takes the bounding rectangle from the caller when it is already known
+// (see the segmenter's contour stats) so the contour isn't simplified again.
+PieceData::PieceData(Mat* src_data, vector<Point> edge_data, Rect bounding_rect) : m_cornerIndexs(4), m_edgeType(4), m_colourStrips(4), m_seamStrips(4), m_edgeTransforms(4)
 {
 	m_edgeData = edge_data;
 
-	//Find piece bounding rectangle
-	Rect bounding_rect = contour_bounding_rect(m_edgeData);
+	//Crop edge_data info
+	for (int i = 0; i < m_edgeData.size(); i++) 
+	{
+		m_edgeData[i].x = m_edgeData[i].x - bounding_rect.x;
+		m_edgeData[i].y = m_edgeData[i].y - bounding_rect.y;
+	}
 
-	//Create mask for piece
-	Mat mask = Mat::zeros(src_data->rows, src_data->cols, CV_8UC3);
+	//Create mask for piece, only as big as the piece itself
+	Mat mask = Mat::zeros(bounding_rect.height, bounding_rect.width, CV_8UC3);
 	
 	vector<vector<Point> > contours;
 	contours.push_back(m_edgeData);
@@ -31,16 +44,7 @@ PieceData::PieceData(Mat* src_data, vector<Point> edge_data) : m_cornerIndexs(4)
 	drawContours(mask, contours, 0, Scalar(255, 255, 255), -1);
 	
 	//Copy and crop the piece
-	bitwise_and(mask, *src_data, m_imageData);
-	m_imageData = m_imageData(bounding_rect);
-
-	//Crop edge_data info
-	for (int i = 0; i < m_edgeData.size(); i++) 
-	{
-		m_edgeData[i].x = m_edgeData[i].x - bounding_rect.x;
-		m_edgeData[i].y = m_edgeData[i].y - bounding_rect.y;
-	}
-
+	bitwise_and(mask, (*src_data)(bounding_rect), m_imageData);
 }
 
 void resolve_filename(string name, string& image_filename, string& edge_filename)
@@ -64,7 +68,7 @@ void resolve_filename(string name, string& image_filename, string& edge_filename
 	}
 }
 
-PieceData::PieceData(string name) : m_cornerIndexs(4), m_edgeType(4)
+PieceData::PieceData(string name) : m_cornerIndexs(4), m_edgeType(4), m_colourStrips(4), m_seamStrips(4), m_edgeTransforms(4)
 {
 	string image_filename;
 	string edge_filename;
@@ -104,6 +108,85 @@ PieceData::PieceData(string name) : m_cornerIndexs(4), m_edgeType(4)
 		
 		if (x != 0) non_zero = true;
 	}
+
+	// What classifying adds comes after the corners in tagged sections,
+	// each with a line per edge. Pieces straight from the segmenter have
+	// none, ones classified before the transforms were stored lack those.
+	bool has_transforms = false;
+	string section;
+
+	while (fs >> section)
+	{
+		if (section == EDG_SECTION_STRIPS)
+		{
+			readColourStrips(fs);
+		}
+		else if (section == EDG_SECTION_TRANSFORMS)
+		{
+			readEdgeTransforms(fs);
+			has_transforms = true;
+		}
+		else if (section == EDG_SECTION_SEAMS)
+		{
+			readSeamStrips(fs);
+		}
+		else
+		{
+			throw runtime_error("Unknown section '" + section + "' in piece, reclassify it");
+		}
+	}
+
+	if (!has_transforms) computeEdgeTransforms();
+}
+
+// A line per edge: the strip length then b g r per column
+void PieceData::readColourStrips(fstream& fs)
+{
+	for (int i = 0; i < EDGE_COUNT; i++)
+	{
+		int strip_length;
+		if (!(fs >> strip_length) || strip_length < 0) throw runtime_error("Failed to read colour strips");
+
+		m_colourStrips[i].resize(strip_length);
+		for (int j = 0; j < strip_length; j++)
+		{
+			int b, g, r;
+			if (!(fs >> b >> g >> r)) throw runtime_error("Failed to read colour strips");
+			m_colourStrips[i][j] = Vec3b(b, g, r);
+		}
+	}
+}
+
+// A line per edge: cos, sin and the translation
+void PieceData::readEdgeTransforms(fstream& fs)
+{
+	for (int i = 0; i < EDGE_COUNT; i++)
+	{
+		double cos_a, sin_a, tx, ty;
+		if (!(fs >> cos_a >> sin_a >> tx >> ty)) throw runtime_error("Failed to read edge transforms");
+
+		m_edgeTransforms[i] = Matx23d(cos_a, sin_a, tx, -sin_a, cos_a, ty);
+	}
+}
+
+// A line per edge: the strip length then per column the boundary pixel
+// and the one inside it, b g r each
+void PieceData::readSeamStrips(fstream& fs)
+{
+	for (int i = 0; i < EDGE_COUNT; i++)
+	{
+		int seam_length;
+		if (!(fs >> seam_length) || seam_length < 0) throw runtime_error("Failed to read seam strips");
+
+		m_seamStrips[i].resize(2 * seam_length);
+		for (int j = 0; j < seam_length; j++)
+		{
+			int b, g, r, inner_b, inner_g, inner_r;
+			if (!(fs >> b >> g >> r >> inner_b >> inner_g >> inner_r)) throw runtime_error("Failed to read seam strips");
+			m_seamStrips[i][j] = Vec3b(b, g, r);
+			m_seamStrips[i][seam_length + j] = Vec3b(inner_b, inner_g, inner_r);
+		}
+	}
 }
 
 
@@ -131,6 +214,64 @@ void PieceData::write(string name)
 		fs << m_cornerIndexs[i] << " " << m_edgeType[i] << endl;
 	}
 
+	bool has_strips = false;
+	bool has_seams = false;
+	bool has_transforms = false;
+
+	for (int i = 0; i < EDGE_COUNT; i++)
+	{
+		if (m_colourStrips[i].size() > 0) has_strips = true;
+		if (m_seamStrips[i].size() > 0) has_seams = true;
+
+		// A rotation always has a non zero cos or sin, the segmenter's
+		// pieces have neither worked out
+		if (m_edgeTransforms[i](0, 0) != 0 || m_edgeTransforms[i](0, 1) != 0) has_transforms = true;
+	}
+
+	if (has_strips)
+	{
+		fs << EDG_SECTION_STRIPS << endl;
+		for (int i = 0; i < EDGE_COUNT; i++)
+		{
+			fs << m_colourStrips[i].size();
+			for (int j = 0; j < m_colourStrips[i].size(); j++)
+			{
+				Vec3b colour = m_colourStrips[i][j];
+				fs << " " << (int)colour[0] << " " << (int)colour[1] << " " << (int)colour[2];
+			}
+			fs << endl;
+		}
+	}
+
+	if (has_transforms)
+	{
+		fs << EDG_SECTION_TRANSFORMS << endl;
+		for (int i = 0; i < EDGE_COUNT; i++)
+		{
+			Matx23d transform = m_edgeTransforms[i];
+			fs << transform(0, 0) << " " << transform(0, 1) << " " << transform(0, 2) << " " << transform(1, 2) << endl;
+		}
+	}
+
+	if (has_seams)
+	{
+		fs << EDG_SECTION_SEAMS << endl;
+		for (int i = 0; i < EDGE_COUNT; i++)
+		{
+			int seam_length = m_seamStrips[i].size() / 2;
+
+			fs << seam_length;
+			for (int j = 0; j < seam_length; j++)
+			{
+				Vec3b colour = m_seamStrips[i][j];
+				Vec3b inner = m_seamStrips[i][seam_length + j];
+				fs << " " << (int)colour[0] << " " << (int)colour[1] << " " << (int)colour[2];
+				fs << " " << (int)inner[0] << " " << (int)inner[1] << " " << (int)inner[2];
+			}
+			fs << endl;
+		}
+	}
+
 	fs.close();
 }
 
@@ -227,6 +368,154 @@ int PieceData::getEdgeType(int num)
 	return m_edgeType[num];
 }
 
+vector<Vec3b>& PieceData::getColourStrip(int num)
+{
+	return m_colourStrips[num];
+}
+
+// The boundary row of the edge followed by the row just inside it, both
+// as long as the colour strip. Empty for pieces classified before seams.
+vector<Vec3b>& PieceData::getSeamStrip(int num)
+{
+	return m_seamStrips[num];
+}
+
+Matx23d PieceData::edgeTransform(int num)
+{
+	return m_edgeTransforms[num];
+}
+
+// The points of an edge in its own frame, see computeEdgeTransform.
+void PieceData::canonicalEdge(int num, vector<Point>& out)
+{
+	Matx23d transform = m_edgeTransforms[num];
+
+	ptIter iter = getEdgeBegin(num);
+	ptIter edge_end = getEdgeEnd(num);
+
+	while (iter != edge_end)
+	{
+		Point p = *iter + m_origin;
+		out.push_back(Point(cvRound(transform(0, 0) * p.x + transform(0, 1) * p.y + transform(0, 2)),
+		                    cvRound(transform(1, 0) * p.x + transform(1, 1) * p.y + transform(1, 2))));
+
+		iter = increment(iter, +1, edge_end);
+	}
+}
+
+// Works out the transform of every edge, needs the corners and origin to
+// have been set.
+void PieceData::computeEdgeTransforms()
+{
+	for (int i = 0; i < EDGE_COUNT; i++)
+	{
+		m_edgeTransforms[i] = computeEdgeTransform(i);
+	}
+}
+
+// Rigid transform from image coordinates to the edge's own frame, where
+// the edge's first corner is at (0, 0) and its second corner lies along
+// the positive x axis.
+Matx23d PieceData::computeEdgeTransform(int num)
+{
+	Point first = m_edgeData[m_cornerIndexs[num]] + m_origin;
+	Point second = m_edgeData[m_cornerIndexs[(num + 1) % EDGE_COUNT]] + m_origin;
+
+	double angle = atan2((double)(second.y - first.y), (double)(second.x - first.x));
+	double cos_a = cos(angle);
+	double sin_a = sin(angle);
+
+	return Matx23d( cos_a, sin_a, -(cos_a * first.x + sin_a * first.y),
+	               -sin_a, cos_a,   sin_a * first.x - cos_a * first.y);
+}
+
+// Works out the colour and seam strips of every edge, see
+// computeColourStrip. Needs the edge transforms to have been worked out.
+void PieceData::computeColourStrips()
+{
+	for (int i = 0; i < EDGE_COUNT; i++)
+	{
+		m_colourStrips[i] = computeColourStrip(i, m_seamStrips[i]);
+	}
+}
+
+// The average colour of the COLOUR_STRIP_DEPTH pixels just inside the
+// edge, for every column along the edge in its own frame. Only the band
+// of image around the edge is warped into the edge frame, then column
+// sums come from an integral image so each column costs four reads.
+// Done once per piece so matching can compare colours without touching
+// the image. The same band gives the seam strip: the pixel SEAM_INSET in
+// from the edge and the one behind it, for gradients across the seam.
+vector<Vec3b> PieceData::computeColourStrip(int num, vector<Vec3b>& seam)
+{
+	Matx23d transform = edgeTransform(num);
+
+	vector<Point2d> points;
+	ptIter iter = getEdgeBegin(num);
+	ptIter edge_end = getEdgeEnd(num);
+
+	while (iter != edge_end)
+	{
+		Point p = *iter + m_origin;
+		points.push_back(Point2d(transform(0, 0) * p.x + transform(0, 1) * p.y + transform(0, 2),
+		                         transform(1, 0) * p.x + transform(1, 1) * p.y + transform(1, 2)));
+
+		iter = increment(iter, +1, edge_end);
+	}
+
+	Point2d last = points.back();
+	int length = max((int)last.x, 1);
+
+	// Which side of the edge the piece is on
+	double centre_y = transform(1, 0) * m_origin.x + transform(1, 1) * m_origin.y + transform(1, 2);
+	int inward = centre_y < 0 ? -1 : 1;
+
+	double min_y = 0;
+	double max_y = 0;
+	for (int i = 0; i < points.size(); i++)
+	{
+		min_y = min(min_y, points[i].y);
+		max_y = max(max_y, points[i].y);
+	}
+
+	int top = (int)floor(min_y) - COLOUR_STRIP_DEPTH - 1;
+	int height = (int)ceil(max_y) - top + COLOUR_STRIP_DEPTH + 2;
+
+	Mat shifted = Mat(transform);
+	shifted.at<double>(1, 2) -= top;
+
+	Mat band;
+	Mat sums;
+	warpAffine(m_imageData, band, shifted, Size(length, height), INTER_LINEAR, BORDER_CONSTANT, Scalar(0, 0, 0));
+	integral(band, sums, CV_32S);
+
+	vector<Vec3b> strip (length);
+	seam.assign(2 * length, Vec3b());
+
+	for (int i = 0; i + 1 < points.size(); i++)
+	{
+		int begin_x = max((int)min(points[i].x, points[i + 1].x), 0);
+		int end_x = min((int)max(points[i].x, points[i + 1].x), length);
+
+		int row = (int)points[i].y - top;
+		int row_begin = inward < 0 ? row - COLOUR_STRIP_DEPTH : row;
+		int row_end = row_begin + COLOUR_STRIP_DEPTH;
+
+		for (int x = begin_x; x < end_x; x++)
+		{
+			Vec3i sum = sums.at<Vec3i>(row_end, x + 1) - sums.at<Vec3i>(row_begin, x + 1)
+			          - sums.at<Vec3i>(row_end, x) + sums.at<Vec3i>(row_begin, x);
+
+			strip[x] = Vec3b(sum[0] / COLOUR_STRIP_DEPTH, sum[1] / COLOUR_STRIP_DEPTH, sum[2] / COLOUR_STRIP_DEPTH);
+
+			seam[x] = band.at<Vec3b>(row + inward * SEAM_INSET, x);
+			seam[length + x] = band.at<Vec3b>(row + inward * (SEAM_INSET + 1), x);
+		}
+	}
+
+	return strip;
+}
+
 // Helper function to increment an iterator taking into account
 // it wrapping around the vector until it finds the end. 
 ptIter PieceData::increment(ptIter iter, int dir, ptIter end)
@@ -29,6 +29,18 @@
 #define CORNER_BOTLEFT 2
 #define CORNER_BOTRIGHT 3
 
+#define COLOUR_STRIP_DEPTH 25
+
+// How far inside the edge the seam rows are taken, clear of the pixels
+// blended with the background
+#define SEAM_INSET 2
+
+// Tags of the optional sections of a .edg file, each followed by a line
+// per edge
+#define EDG_SECTION_STRIPS "strips"
+#define EDG_SECTION_TRANSFORMS "transforms"
+#define EDG_SECTION_SEAMS "seams"
+
 using namespace cv;
 using namespace std;
 
@@ -43,17 +55,30 @@ class PieceData {
 		vector<Point> m_edgeData;
 		vector<int> m_cornerIndexs;
 		vector<int> m_edgeType;
+		vector<vector<Vec3b> > m_colourStrips;
+		vector<vector<Vec3b> > m_seamStrips;
+		vector<Matx23d> m_edgeTransforms;
 		Point m_origin;
 
+		Matx23d computeEdgeTransform(int edge);
+		vector<Vec3b> computeColourStrip(int edge, vector<Vec3b>& seam);
+		void readColourStrips(fstream& fs);
+		void readEdgeTransforms(fstream& fs);
+		void readSeamStrips(fstream& fs);
+
 
 	public:
+		PieceData();
 		PieceData(Mat image_data, vector<Point> edge_data);
 		PieceData(Mat* src_data, vector<Point> edge_data);
+		PieceData(Mat* src_data, vector<Point> edge_data, Rect bounding_rect);
 		PieceData(string filename);
 
 		void setOrigin(Point origin);
 		void setCornerIndexs(vector<int> indexs);
 		void setEdgeType(int edge, int type);
+		void computeEdgeTransforms();
+		void computeColourStrips();
 
 		void rotate(double rotation);
 
@@ -76,6 +101,10 @@ class PieceData {
 		ptIter increment(ptIter iter, int dir, ptIter end);
 		
 		int getEdgeType(int num);
+		vector<Vec3b>& getColourStrip(int num);
+		vector<Vec3b>& getSeamStrip(int num);
+		Matx23d edgeTransform(int num);
+		void canonicalEdge(int num, vector<Point>& out);
 	};
 
 
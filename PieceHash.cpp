@@ -0,0 +1,197 @@
+#include "PieceHash.h"
+
+#include <cmath>
+#include <algorithm>
+#include <map>
+
+// The piece's image with everything outside its outline blacked out, and
+// the outline in image coordinates
+void masked_piece(PieceData& piece, Mat& gray, Mat& mask, vector<Point>& outline)
+{
+	outline = piece.edge();
+	for (int i = 0; i < outline.size(); i++) outline[i] += piece.origin();
+
+	mask = Mat::zeros(piece.image().size(), CV_8UC1);
+	fillPoly(mask, vector<vector<Point> >(1, outline), Scalar(255));
+
+	Mat full;
+	cvtColor(piece.image(), full, CV_BGR2GRAY);
+
+	gray = Mat::zeros(full.size(), CV_8UC1);
+	full.copyTo(gray, mask);
+}
+
+// Samples the masked image on rings about the outline's centroid, out to
+// its furthest point, so the samples scale with the piece. Turning the
+// piece only shifts each ring round, which leaves its mean and the
+// magnitudes of its low frequencies alone. Each of those features gives
+// a bit per ring, see feature_hash.
+uint64_t ring_hash(Mat& gray, vector<Point>& outline, Moments& m)
+{
+	Point2d centre (m.m10 / m.m00, m.m01 / m.m00);
+
+	double radius = 1;
+	for (int i = 0; i < outline.size(); i++)
+	{
+		radius = max(radius, hypot(outline[i].x - centre.x, outline[i].y - centre.y));
+	}
+
+	double features[HASH_RING_FEATURES][HASH_RINGS];
+
+	for (int r = 0; r < HASH_RINGS; r++)
+	{
+		double ring_radius = radius * (r + 0.5) / HASH_RINGS;
+		double samples[HASH_RING_SAMPLES];
+
+		for (int s = 0; s < HASH_RING_SAMPLES; s++)
+		{
+			double angle = 2 * PI * s / HASH_RING_SAMPLES;
+			int x = min(max(cvRound(centre.x + ring_radius * cos(angle)), 0), gray.cols - 1);
+			int y = min(max(cvRound(centre.y + ring_radius * sin(angle)), 0), gray.rows - 1);
+
+			samples[s] = gray.at<uchar>(y, x);
+		}
+
+		for (int f = 0; f < HASH_RING_FEATURES; f++)
+		{
+			double re = 0;
+			double im = 0;
+
+			for (int s = 0; s < HASH_RING_SAMPLES; s++)
+			{
+				double angle = 2 * PI * f * s / HASH_RING_SAMPLES;
+				re += samples[s] * cos(angle);
+				im += samples[s] * sin(angle);
+			}
+
+			features[f][r] = hypot(re, im) / HASH_RING_SAMPLES;
+		}
+	}
+
+	return feature_hash(features);
+}
+
+// A feature's bits are set for the upper half of its rings, ties going
+// to the outer ring, so every feature sets exactly HASH_RINGS / 2 bits
+// even when rings tie (a plain ring is common). group_duplicates relies
+// on that.
+uint64_t feature_hash(double features[HASH_RING_FEATURES][HASH_RINGS])
+{
+	uint64_t hash = 0;
+
+	for (int f = 0; f < HASH_RING_FEATURES; f++)
+	{
+		vector<pair<double, int> > rings (HASH_RINGS);
+		for (int r = 0; r < HASH_RINGS; r++) rings[r] = make_pair(features[f][r], r);
+
+		nth_element(rings.begin(), rings.begin() + HASH_RINGS / 2, rings.end());
+
+		for (int i = HASH_RINGS / 2; i < HASH_RINGS; i++)
+		{
+			hash |= (uint64_t)1 << (f * HASH_RINGS + rings[i].second);
+		}
+	}
+
+	return hash;
+}
+
+void piece_signature(PieceData& piece, PieceSignature& signature)
+{
+	Mat gray;
+	Mat mask;
+	vector<Point> outline;
+	masked_piece(piece, gray, mask, outline);
+
+	Moments m = moments(outline);
+	double hu[7];
+	HuMoments(m, hu);
+
+	// Hu moments span orders of magnitude, their logs compare evenly
+	for (int i = 0; i < 7; i++)
+	{
+		signature.shape[i] = hu[i] == 0 ? 0 : -copysign(1.0, hu[i]) * log10(fabs(hu[i]));
+	}
+
+	signature.area = m.m00;
+	signature.hash = m.m00 > 0 ? ring_hash(gray, outline, m) : 0;
+
+	// Blur shows as a weak Laplacian. The mask is eroded so the outline
+	// itself doesn't count.
+	Mat laplacian;
+	Mat inside;
+	Laplacian(gray, laplacian, CV_64F);
+	erode(mask, inside, Mat(), Point(-1, -1), 2);
+
+	Scalar mean;
+	Scalar deviation;
+	meanStdDev(laplacian, mean, deviation, inside);
+	signature.sharpness = deviation[0] * deviation[0];
+}
+
+int hash_distance(uint64_t a, uint64_t b)
+{
+	return __builtin_popcountll(a ^ b);
+}
+
+bool near_duplicate(PieceSignature& a, PieceSignature& b)
+{
+	if (hash_distance(a.hash, b.hash) > DUPLICATE_HASH_DISTANCE) return false;
+
+	if (max(a.area, b.area) > DUPLICATE_AREA_RATIO * min(a.area, b.area)) return false;
+
+	double shape = 0;
+	for (int i = 0; i < 7; i++) shape += fabs(a.shape[i] - b.shape[i]);
+
+	return shape / 7 <= DUPLICATE_SHAPE_DISTANCE;
+}
+
+int find_group(vector<int>& group, int i)
+{
+	while (group[i] != i)
+	{
+		group[i] = group[group[i]];
+		i = group[i];
+	}
+
+	return i;
+}
+
+// Sets group[i] to the lowest numbered piece that piece i is a near
+// duplicate of, directly or through others. Rather than comparing every
+// pair, each hash is filed under each of its HASH_BANDS bands, and a
+// piece is only compared with those already filed under one of its bands
+// (multi-index hashing). Near duplicates are at most
+// DUPLICATE_HASH_DISTANCE bits apart, within the 2 * HASH_BANDS - 1 an
+// exact band match is sure to find (see HASH_BANDS).
+void group_duplicates(vector<PieceSignature>& signatures, vector<int>& group)
+{
+	group.resize(signatures.size());
+	for (int i = 0; i < group.size(); i++) group[i] = i;
+
+	vector<map<uint64_t, vector<int> > > index (HASH_BANDS);
+	uint64_t band_mask = ((uint64_t)1 << HASH_BAND_BITS) - 1;
+
+	for (int i = 0; i < signatures.size(); i++)
+	{
+		for (int band = 0; band < HASH_BANDS; band++)
+		{
+			uint64_t key = signatures[i].hash >> (band * HASH_BAND_BITS) & band_mask;
+			vector<int>& bucket = index[band][key];
+
+			for (int b = 0; b < bucket.size(); b++)
+			{
+				int j = bucket[b];
+				int group_i = find_group(group, i);
+				int group_j = find_group(group, j);
+
+				if (group_i == group_j || !near_duplicate(signatures[i], signatures[j])) continue;
+
+				group[max(group_i, group_j)] = min(group_i, group_j);
+			}
+
+			bucket.push_back(i);
+		}
+	}
+
+	for (int i = 0; i < group.size(); i++) group[i] = find_group(group, i);
+}
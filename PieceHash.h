@@ -0,0 +1,49 @@
+#ifndef _PIECE_HASH_
+#define _PIECE_HASH_
+
+#include "opencv2/imgproc/imgproc.hpp"
+
+#include <vector>
+#include <cstdint>
+
+#include "PieceData.h"
+
+// Rings and samples round each ring of the image hash. Every ring gives
+// HASH_RING_FEATURES bits, so rings * features is the 64 bit hash.
+#define HASH_RINGS 16
+#define HASH_RING_SAMPLES 64
+#define HASH_RING_FEATURES 4
+
+// The hash is indexed in this many bands of bits, a band per feature.
+// Every band has exactly half its bits set, so two hashes differ in each
+// band by an even number of bits, and hashes at most 2 * HASH_BANDS - 1
+// bits apart match exactly in some band, so none is missed.
+#define HASH_BANDS HASH_RING_FEATURES
+#define HASH_BAND_BITS (64 / HASH_BANDS)
+
+// Near duplicates: hashes at most this many bits apart, log Hu moments
+// at most this far apart on average and areas within this ratio
+#define DUPLICATE_HASH_DISTANCE 6
+#define DUPLICATE_SHAPE_DISTANCE 0.15
+#define DUPLICATE_AREA_RATIO 1.1
+
+using namespace std;
+using namespace cv;
+
+// What dedup compares of a piece. hash is a rotation tolerant hash of
+// the piece's masked image, shape the log Hu moments of its outline,
+// sharpness the variance of the Laplacian inside it.
+struct PieceSignature
+{
+	uint64_t hash;
+	double shape[7];
+	double area;
+	double sharpness;
+};
+
+uint64_t feature_hash(double features[HASH_RING_FEATURES][HASH_RINGS]);
+void piece_signature(PieceData& piece, PieceSignature& signature);
+bool near_duplicate(PieceSignature& a, PieceSignature& b);
+void group_duplicates(vector<PieceSignature>& signatures, vector<int>& group);
+
+#endif
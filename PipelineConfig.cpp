@@ -0,0 +1,77 @@
+#include "PipelineConfig.h"
+#include "CornerFinder.h"
+
+PipelineConfig default_pipeline_config()
+{
+	PipelineConfig config;
+	config.name = DEFAULT_PRESET;
+
+	config.resize_divider = RESIZE_DIVIDER;
+	config.segment.blur_size = BLUR_KERNEL_SIZE;
+	config.segment.canny_thresholds[0] = CANNY_THRESHOLD_B;
+	config.segment.canny_thresholds[1] = CANNY_THRESHOLD_G;
+	config.segment.canny_thresholds[2] = CANNY_THRESHOLD_R;
+	config.segment.close_size = MORPH_CLOSE_SIZE;
+	config.segment.open_size = MORPH_OPEN_SIZE;
+	config.segment.filter_change_percent = FILTER_CHANGE_PERCENT;
+
+	config.edge_simplify_amount = EDGE_SIMPLIFY_AMOUNT;
+	config.right_angle_diff = RIGHT_ANGLE_DIFF;
+	config.edge_stray_threshold = EDGE_STRAY_THRESHOLD;
+	config.edge_bias_threshold = EDGE_BIAS_THRESHOLD;
+
+	config.confidence_threshold = CLASSIFY_CONFIDENCE_THRESHOLD;
+	config.fallback_simplify_amount = FALLBACK_SIMPLIFY_AMOUNT;
+	config.fallback_right_angle_diff = FALLBACK_RIGHT_ANGLE_DIFF;
+
+	config.coupling_distance_threshold = COUPLING_DISTANCE_THRESHOLD;
+	config.avg_min_distance_threshold = AVG_MIN_DISTANCE_THRESHOLD;
+
+	return config;
+}
+
+// Fills config with the named preset, returns false if there is no such
+// preset.
+// "fast" finds edges at half resolution (the close kernel shrinks to
+// match, the mask is still opened at full size) and simplifies contours
+// more coarsely before looking for corners, only sending pieces it is
+// really unsure of to the classifier's second pass.
+// "accurate" picks up fainter edges, keeps more contour detail for the
+// corner finder and edge classifier and is quicker to try a second pass.
+bool pipeline_preset(string name, PipelineConfig& config)
+{
+	config = default_pipeline_config();
+	config.name = name;
+
+	if (name == DEFAULT_PRESET)
+	{
+		return true;
+	}
+
+	if (name == "fast")
+	{
+		config.resize_divider = 2;
+		config.segment.close_size = 3;
+		config.edge_simplify_amount = 20;
+		config.confidence_threshold = 0.25;
+		return true;
+	}
+
+	if (name == "accurate")
+	{
+		config.segment.canny_thresholds[0] = 30;
+		config.segment.canny_thresholds[1] = 30;
+		config.segment.canny_thresholds[2] = 30;
+		config.edge_simplify_amount = 6;
+		config.confidence_threshold = 0.75;
+		config.fallback_simplify_amount = 3;
+		return true;
+	}
+
+	return false;
+}
+
+string pipeline_preset_names()
+{
+	return string(DEFAULT_PRESET) + ", fast, accurate";
+}
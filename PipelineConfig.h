@@ -0,0 +1,59 @@
+#ifndef _PIPELINE_CONFIG_
+#define _PIPELINE_CONFIG_
+
+#include <string>
+
+#include "Segmentation.h"
+
+// Values for the "default" preset
+#define RESIZE_DIVIDER 1
+
+#define EDGE_STRAY_THRESHOLD 5
+#define EDGE_BIAS_THRESHOLD 5
+
+#define EDGE_SIMPLIFY_AMOUNT 15
+
+#define CLASSIFY_CONFIDENCE_THRESHOLD 0.5
+#define FALLBACK_SIMPLIFY_AMOUNT 5
+#define FALLBACK_RIGHT_ANGLE_DIFF 10.0
+
+#define COUPLING_DISTANCE_THRESHOLD 35
+#define AVG_MIN_DISTANCE_THRESHOLD 20
+
+#define DEFAULT_PRESET "default"
+
+using namespace std;
+
+// Every tuning value of the pipeline, so a run can pick a speed or
+// accuracy trade off without a rebuild. Each program only reads its
+// own part.
+struct PipelineConfig
+{
+	string name;
+
+	// Segmenter
+	int resize_divider;
+	SegmentParams segment;
+
+	// PieceClassifier
+	int edge_simplify_amount;
+	double right_angle_diff;
+	int edge_stray_threshold;
+	int edge_bias_threshold;
+
+	// Pieces classified with less confidence than this get a second pass
+	// with the fallback settings
+	double confidence_threshold;
+	int fallback_simplify_amount;
+	double fallback_right_angle_diff;
+
+	// EdgeMatcher
+	double coupling_distance_threshold;
+	double avg_min_distance_threshold;
+};
+
+PipelineConfig default_pipeline_config();
+bool pipeline_preset(string name, PipelineConfig& config);
+string pipeline_preset_names();
+
+#endif
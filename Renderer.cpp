@@ -0,0 +1,351 @@
+#include "opencv2/imgproc/imgproc.hpp"
+#include "opencv2/highgui/highgui.hpp"
+
+#include <iostream>
+#include <algorithm>
+#include <string>
+#include <fstream>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <functional>
+
+#include "PieceData.h"
+#include "OccupancyGrid.h"
+
+// Pixels across a slot in the render
+#define RENDER_SLOT_PIXELS 64
+
+// How far past its slot a piece's image reaches, in slots, to take in
+// the knobs
+#define RENDER_PIECE_SPAN 1.6
+
+// Output rows composited and written at once, and the width of the tiles
+// a strip is split into across threads
+#define RENDER_STRIP_ROWS 256
+#define RENDER_TILE_COLS 256
+
+#define DEFAULT_RENDER_FILE "solution.ppm"
+
+using namespace std;
+using namespace cv;
+
+// A piece of the solution and where its image lands in the render.
+// image and mask are only held while strips overlapping bounds are drawn.
+struct RenderPiece
+{
+	string name;
+	int rotation;
+	Rect bounds;
+	Mat image;
+	Mat mask;
+	bool failed;
+};
+
+//--- Forward declarations
+int render(string solution_filename, string output_filename, int slot_pixels, int thread_count);
+bool read_solution(string solution_filename, vector<RenderPiece>& pieces, int slot_pixels, Size& canvas);
+void prepare_piece(RenderPiece& piece, int slot_pixels);
+void composite_tile(Mat& strip, Rect strip_rect, Rect tile, vector<RenderPiece*>& active);
+void write_ppm_strip(fstream& fs, Mat& strip, Mat& rgb);
+void run_tasks(int task_count, int thread_count, function<void(int)> task);
+bool bounds_above(const RenderPiece& a, const RenderPiece& b);
+//---
+
+// argv should contain a solution file written by Solver. The assembled
+// puzzle is written as a binary PPM.
+// '-s <pixels>' sets the size of a slot (one piece) in the render.
+// '-j <threads>' sets the number of threads (all cores by default).
+// '-o <file>' names the output image.
+int main(int argc, char* argv[])
+{
+	int slot_pixels = RENDER_SLOT_PIXELS;
+	int thread_count = max((int)thread::hardware_concurrency(), 1);
+	string output_filename = DEFAULT_RENDER_FILE;
+	string solution_filename;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+		{
+			slot_pixels = max(atoi(argv[++i]), 1);
+			continue;
+		}
+
+		if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+		{
+			thread_count = max(atoi(argv[++i]), 1);
+			continue;
+		}
+
+		if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+		{
+			output_filename = string(argv[++i]);
+			continue;
+		}
+
+		solution_filename = string(argv[i]);
+	}
+
+	if (solution_filename.size() == 0)
+	{
+		cout << "Usage: Renderer [-s slot_pixels] [-j threads] [-o output] solution" << endl;
+		return EXIT_FAILURE;
+	}
+
+	return render(solution_filename, output_filename, slot_pixels, thread_count);
+}
+
+// Renders the solution a strip of rows at a time so only one strip of the
+// output, and the pieces that reach into it, are in memory at once. Pieces
+// are loaded as the strips reach them and let go once they are passed.
+// Each strip is split into tiles composited in parallel, every tile
+// copying the pieces over it through their outline masks.
+int render(string solution_filename, string output_filename, int slot_pixels, int thread_count)
+{
+	int64 start = getTickCount();
+
+	vector<RenderPiece> pieces;
+	Size canvas;
+
+	if (!read_solution(solution_filename, pieces, slot_pixels, canvas)) return EXIT_FAILURE;
+
+	sort(pieces.begin(), pieces.end(), bounds_above);
+
+	fstream fs (output_filename.c_str(), fstream::out | fstream::binary);
+
+	if (!fs.is_open())
+	{
+		cout << "Error on output '" << output_filename << "'. Failed to open." << endl;
+		return EXIT_FAILURE;
+	}
+
+	fs << "P6\n" << canvas.width << " " << canvas.height << "\n255\n";
+
+	int tile_count = (canvas.width + RENDER_TILE_COLS - 1) / RENDER_TILE_COLS;
+	int next_piece = 0;
+	int failed = 0;
+	vector<RenderPiece*> active;
+	Mat strip;
+	Mat rgb;
+
+	for (int y = 0; y < canvas.height; y += RENDER_STRIP_ROWS)
+	{
+		Rect strip_rect (0, y, canvas.width, min(RENDER_STRIP_ROWS, canvas.height - y));
+
+		// Drop pieces that ended above this strip
+		for (int i = 0; i < active.size(); i++)
+		{
+			if (active[i]->bounds.y + active[i]->bounds.height > y) continue;
+
+			active[i]->image.release();
+			active[i]->mask.release();
+			active.erase(active.begin() + i--);
+		}
+
+		// Load the pieces that start in this strip, in parallel
+		int first_new = next_piece;
+		while (next_piece < pieces.size() && pieces[next_piece].bounds.y < strip_rect.y + strip_rect.height)
+		{
+			next_piece++;
+		}
+
+		run_tasks(next_piece - first_new, thread_count, [&](int i)
+		{
+			prepare_piece(pieces[first_new + i], slot_pixels);
+		});
+
+		for (int i = first_new; i < next_piece; i++)
+		{
+			if (pieces[i].failed) failed++;
+			else active.push_back(&pieces[i]);
+		}
+
+		strip.create(strip_rect.height, strip_rect.width, CV_8UC3);
+		strip.setTo(Scalar(0, 0, 0));
+
+		run_tasks(tile_count, thread_count, [&](int t)
+		{
+			Rect tile (t * RENDER_TILE_COLS, strip_rect.y, min(RENDER_TILE_COLS, canvas.width - t * RENDER_TILE_COLS), strip_rect.height);
+			composite_tile(strip, strip_rect, tile, active);
+		});
+
+		write_ppm_strip(fs, strip, rgb);
+	}
+
+	fs.close();
+
+	double seconds = (getTickCount() - start) / getTickFrequency();
+
+	cout << "Rendered " << pieces.size() - failed << " of " << pieces.size() << " pieces to '" << output_filename << "' (";
+	cout << canvas.width << "x" << canvas.height << ") in " << seconds << "s on " << thread_count << " threads" << endl;
+
+	return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Reads the placements and works out where each piece's image lands,
+// slot centres being slot_pixels apart. canvas is set to the size of the
+// whole render.
+bool read_solution(string solution_filename, vector<RenderPiece>& pieces, int slot_pixels, Size& canvas)
+{
+	fstream fs (solution_filename.c_str(), fstream::in);
+
+	if (!fs.is_open())
+	{
+		cout << "Error on solution '" << solution_filename << "'. Failed to open." << endl;
+		return false;
+	}
+
+	int span = (int)ceil(slot_pixels * RENDER_PIECE_SPAN);
+	int cols = 0;
+	int rows = 0;
+
+	RenderPiece piece;
+	int x;
+	int y;
+
+	while (fs >> piece.name >> x >> y >> piece.rotation)
+	{
+		Point centre (x * slot_pixels + slot_pixels / 2, y * slot_pixels + slot_pixels / 2);
+
+		piece.bounds = Rect(centre.x - span / 2, centre.y - span / 2, span, span);
+		piece.failed = false;
+		pieces.push_back(piece);
+
+		cols = max(cols, x + 1);
+		rows = max(rows, y + 1);
+	}
+
+	fs.close();
+
+	if (pieces.size() == 0)
+	{
+		cout << "Error on solution '" << solution_filename << "'. No placements." << endl;
+		return false;
+	}
+
+	canvas = Size(cols * slot_pixels, rows * slot_pixels);
+	return true;
+}
+
+// Loads the piece and draws it into its bounds: squared up on its top
+// corners, turned by its rotation and scaled so its sides are a slot
+// long. The mask is the filled outline put through the same transform.
+void prepare_piece(RenderPiece& piece, int slot_pixels)
+{
+	PieceData pd;
+
+	try
+	{
+		pd = PieceData(piece.name);
+	}
+	catch (runtime_error& e)
+	{
+		cout << "Error on piece '" << piece.name << "'. " << e.what() << "." << endl;
+		piece.failed = true;
+		return;
+	}
+
+	Point origin = pd.origin();
+	Point corners[4] = { pd.getTopRightCorner(), pd.getTopLeftCorner(), pd.getBotLeftCorner(), pd.getBotRightCorner() };
+
+	double centre_x = 0;
+	double centre_y = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		centre_x += (corners[i].x + origin.x) / 4.0;
+		centre_y += (corners[i].y + origin.y) / 4.0;
+	}
+
+	double angle = atan2((double)(corners[0].y - corners[1].y), (double)(corners[0].x - corners[1].x));
+	double scale = slot_pixels / max(piece_side_length(pd), 1.0);
+
+	// Square up, then quarter turns anticlockwise: (x, y) -> (y, -x)
+	Matx22d turn (cos(angle), sin(angle), -sin(angle), cos(angle));
+	for (int q = 0; q < piece.rotation % EDGE_COUNT; q++)
+	{
+		turn = Matx22d(turn(1, 0), turn(1, 1), -turn(0, 0), -turn(0, 1));
+	}
+
+	double half = piece.bounds.width / 2.0;
+	Matx23d transform (
+		scale * turn(0, 0), scale * turn(0, 1), half - scale * (turn(0, 0) * centre_x + turn(0, 1) * centre_y),
+		scale * turn(1, 0), scale * turn(1, 1), half - scale * (turn(1, 0) * centre_x + turn(1, 1) * centre_y));
+
+	warpAffine(pd.image(), piece.image, Mat(transform), piece.bounds.size(), INTER_AREA, BORDER_CONSTANT, Scalar(0, 0, 0));
+
+	vector<vector<Point> > outline (1);
+	vector<Point> edge = pd.edge();
+
+	for (int i = 0; i < edge.size(); i++)
+	{
+		Point p = edge[i] + origin;
+		outline[0].push_back(Point(cvRound(transform(0, 0) * p.x + transform(0, 1) * p.y + transform(0, 2)),
+		                           cvRound(transform(1, 0) * p.x + transform(1, 1) * p.y + transform(1, 2))));
+	}
+
+	piece.mask = Mat::zeros(piece.bounds.size(), CV_8UC1);
+	fillPoly(piece.mask, outline, Scalar(255));
+}
+
+// Copies every active piece over the tile through its mask. Tiles don't
+// overlap so they can be drawn at the same time.
+void composite_tile(Mat& strip, Rect strip_rect, Rect tile, vector<RenderPiece*>& active)
+{
+	for (int i = 0; i < active.size(); i++)
+	{
+		RenderPiece& piece = *active[i];
+		Rect area = piece.bounds & tile;
+
+		if (area.width <= 0 || area.height <= 0) continue;
+
+		Rect in_piece (area.x - piece.bounds.x, area.y - piece.bounds.y, area.width, area.height);
+		Rect in_strip (area.x - strip_rect.x, area.y - strip_rect.y, area.width, area.height);
+
+		Mat target = strip(in_strip);
+		piece.image(in_piece).copyTo(target, piece.mask(in_piece));
+	}
+}
+
+// PPM rows are RGB
+void write_ppm_strip(fstream& fs, Mat& strip, Mat& rgb)
+{
+	cvtColor(strip, rgb, CV_BGR2RGB);
+
+	for (int y = 0; y < rgb.rows; y++)
+	{
+		fs.write((const char*)rgb.ptr(y), rgb.cols * rgb.elemSize());
+	}
+}
+
+// Runs task(0) to task(task_count - 1) over a pool of threads.
+void run_tasks(int task_count, int thread_count, function<void(int)> task)
+{
+	atomic<int> next_task (0);
+	vector<thread> workers;
+
+	for (int t = 0; t < min(thread_count, task_count); t++)
+	{
+		workers.push_back(thread([&]()
+		{
+			int i;
+			while ((i = next_task++) < task_count)
+			{
+				task(i);
+			}
+		}));
+	}
+
+	for (int t = 0; t < workers.size(); t++)
+	{
+		workers[t].join();
+	}
+}
+
+bool bounds_above(const RenderPiece& a, const RenderPiece& b)
+{
+	return a.bounds.y < b.bounds.y;
+}
@@ -0,0 +1,136 @@
+#include "SeamScore.h"
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+// The gradient across an edge is how the boundary row differs from the
+// row behind it. A good match carries that gradient on across the seam,
+// so the edge's own gradients give the distribution (mean and covariance)
+// the step to the other piece's boundary is judged against.
+void build_seam_model(vector<Vec3b>& seam, SeamModel& model)
+{
+	int length = seam.size() / 2;
+
+	model.valid = length >= 2;
+	if (!model.valid) return;
+
+	double mean[3] = { 0, 0, 0 };
+	for (int x = 0; x < length; x++)
+	{
+		for (int c = 0; c < 3; c++) mean[c] += seam[x][c] - seam[length + x][c];
+	}
+	for (int c = 0; c < 3; c++) mean[c] /= length;
+
+	double cov[3][3] = { { 0, 0, 0 }, { 0, 0, 0 }, { 0, 0, 0 } };
+	for (int x = 0; x < length; x++)
+	{
+		double d[3];
+		for (int c = 0; c < 3; c++) d[c] = seam[x][c] - seam[length + x][c] - mean[c];
+
+		for (int a = 0; a < 3; a++)
+		{
+			for (int b = 0; b < 3; b++) cov[a][b] += d[a] * d[b];
+		}
+	}
+	for (int a = 0; a < 3; a++)
+	{
+		for (int b = 0; b < 3; b++) cov[a][b] /= length - 1;
+		cov[a][a] += SEAM_COVARIANCE_PRIOR;
+	}
+
+	// Symmetric 3x3 inverse by cofactors, the prior keeps det positive
+	double c00 = cov[1][1] * cov[2][2] - cov[1][2] * cov[1][2];
+	double c01 = cov[0][2] * cov[1][2] - cov[0][1] * cov[2][2];
+	double c02 = cov[0][1] * cov[1][2] - cov[0][2] * cov[1][1];
+	double c11 = cov[0][0] * cov[2][2] - cov[0][2] * cov[0][2];
+	double c12 = cov[0][1] * cov[0][2] - cov[0][0] * cov[1][2];
+	double c22 = cov[0][0] * cov[1][1] - cov[0][1] * cov[0][1];
+	double det = cov[0][0] * c00 + cov[0][1] * c01 + cov[0][2] * c02;
+
+	model.inverse[0] = c00 / det;
+	model.inverse[1] = c01 / det;
+	model.inverse[2] = c02 / det;
+	model.inverse[3] = c11 / det;
+	model.inverse[4] = c12 / det;
+	model.inverse[5] = c22 / det;
+
+	for (int c = 0; c < 3; c++) model.mean[c] = mean[c];
+
+	for (int i = 0; i < SEAM_SAMPLES; i++)
+	{
+		int x = ((2 * i + 1) * length) / (2 * SEAM_SAMPLES);
+		for (int c = 0; c < 3; c++) model.boundary[c][i] = seam[x][c];
+	}
+}
+
+// Sum over the seam of the Mahalanobis distance, under self's gradient
+// model, of the step from self's boundary to other's. other runs the
+// opposite way along the seam so it is read backwards.
+double seam_direction(SeamModel& self, SeamModel& other)
+{
+#ifdef __SSE__
+	__m128 m0 = _mm_set1_ps(self.mean[0]);
+	__m128 m1 = _mm_set1_ps(self.mean[1]);
+	__m128 m2 = _mm_set1_ps(self.mean[2]);
+	__m128 i00 = _mm_set1_ps(self.inverse[0]);
+	__m128 i01 = _mm_set1_ps(2 * self.inverse[1]);
+	__m128 i02 = _mm_set1_ps(2 * self.inverse[2]);
+	__m128 i11 = _mm_set1_ps(self.inverse[3]);
+	__m128 i12 = _mm_set1_ps(2 * self.inverse[4]);
+	__m128 i22 = _mm_set1_ps(self.inverse[5]);
+	__m128 total = _mm_setzero_ps();
+
+	for (int i = 0; i < SEAM_SAMPLES; i += 4)
+	{
+		int j = SEAM_SAMPLES - 4 - i;
+
+		__m128 o0 = _mm_loadu_ps(&other.boundary[0][j]);
+		__m128 o1 = _mm_loadu_ps(&other.boundary[1][j]);
+		__m128 o2 = _mm_loadu_ps(&other.boundary[2][j]);
+		o0 = _mm_shuffle_ps(o0, o0, _MM_SHUFFLE(0, 1, 2, 3));
+		o1 = _mm_shuffle_ps(o1, o1, _MM_SHUFFLE(0, 1, 2, 3));
+		o2 = _mm_shuffle_ps(o2, o2, _MM_SHUFFLE(0, 1, 2, 3));
+
+		__m128 d0 = _mm_sub_ps(_mm_sub_ps(o0, _mm_loadu_ps(&self.boundary[0][i])), m0);
+		__m128 d1 = _mm_sub_ps(_mm_sub_ps(o1, _mm_loadu_ps(&self.boundary[1][i])), m1);
+		__m128 d2 = _mm_sub_ps(_mm_sub_ps(o2, _mm_loadu_ps(&self.boundary[2][i])), m2);
+
+		__m128 row0 = _mm_add_ps(_mm_mul_ps(i00, d0), _mm_add_ps(_mm_mul_ps(i01, d1), _mm_mul_ps(i02, d2)));
+		__m128 row1 = _mm_add_ps(_mm_mul_ps(i11, d1), _mm_mul_ps(i12, d2));
+		__m128 row2 = _mm_mul_ps(i22, d2);
+
+		total = _mm_add_ps(total, _mm_add_ps(_mm_mul_ps(d0, row0), _mm_add_ps(_mm_mul_ps(d1, row1), _mm_mul_ps(d2, row2))));
+	}
+
+	float lanes[4];
+	_mm_storeu_ps(lanes, total);
+
+	return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#else
+	float* inv = self.inverse;
+	float total = 0;
+
+	for (int i = 0; i < SEAM_SAMPLES; i++)
+	{
+		int j = SEAM_SAMPLES - 1 - i;
+
+		float d0 = other.boundary[0][j] - self.boundary[0][i] - self.mean[0];
+		float d1 = other.boundary[1][j] - self.boundary[1][i] - self.mean[1];
+		float d2 = other.boundary[2][j] - self.boundary[2][i] - self.mean[2];
+
+		total += d0 * (inv[0] * d0 + 2 * inv[1] * d1 + 2 * inv[2] * d2) + d1 * (inv[3] * d1 + 2 * inv[4] * d2) + d2 * inv[5] * d2;
+	}
+
+	return total;
+#endif
+}
+
+// Mahalanobis gradient compatibility of an in edge and the out edge
+// against it, both ways round, per column. -1 if either has no seam.
+double seam_distance(SeamModel& in, SeamModel& out)
+{
+	if (!in.valid || !out.valid) return -1;
+
+	return (seam_direction(in, out) + seam_direction(out, in)) / (2 * SEAM_SAMPLES);
+}
@@ -0,0 +1,33 @@
+#ifndef _SEAM_SCORE_
+#define _SEAM_SCORE_
+
+#include "opencv2/core/core.hpp"
+
+#include <vector>
+
+// Columns every seam is resampled to, a multiple of 4 for the kernel
+#define SEAM_SAMPLES 64
+
+// Added to the diagonal of an edge's gradient covariance, so an edge of
+// flat colour doesn't make it singular
+#define SEAM_COVARIANCE_PRIOR 4.0
+
+using namespace std;
+using namespace cv;
+
+// What scoring needs of one edge's seam strip (see PieceData): its
+// boundary row resampled to SEAM_SAMPLES columns, one row per channel, and
+// the mean and inverse covariance of the gradient from the row inside to
+// the boundary row. inverse is the upper triangle, 00 01 02 11 12 22.
+struct SeamModel
+{
+	bool valid;
+	float boundary[3][SEAM_SAMPLES];
+	float mean[3];
+	float inverse[6];
+};
+
+void build_seam_model(vector<Vec3b>& seam, SeamModel& model);
+double seam_distance(SeamModel& in, SeamModel& out);
+
+#endif
@@ -0,0 +1,413 @@
+#include "opencv2/imgproc/imgproc.hpp"
+#include "opencv2/highgui/highgui.hpp"
+
+#include <iostream>
+#include <algorithm>
+#include <string>
+#include <fstream>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <functional>
+
+#include "Segmentation.h"
+#include "PipelineConfig.h"
+#include "Morphology.h"
+#include "Workspace.h"
+
+// Canny's aperture follows the blur size, so blur sizes must be 3, 5 or 7
+#define SWEEP_BLUR_SIZES { 3, 5 }
+#define SWEEP_CANNY_THRESHOLDS { 20, 30, 40, 60, 80 }
+#define SWEEP_CLOSE_SIZES { 3, 5, 9 }
+#define SWEEP_FILTER_PERCENTS { 0, 10, 15, 25 }
+#define SWEEP_OPEN_SIZES { 15, 25, 35 }
+
+#define SWEEP_REPORT_TOP 10
+
+#define DEFAULT_REPORT_FILE "sweep.csv"
+
+using namespace std;
+using namespace cv;
+
+// The values tried for each parameter. Every combination is a setting,
+// numbered with the open size changing fastest and the blur size slowest,
+// which is also the order the stages run in.
+struct SweepGrid
+{
+	vector<int> blur_sizes;
+	vector<int> canny_thresholds;
+	vector<int> close_sizes;
+	vector<int> filter_percents;
+	vector<int> open_sizes;
+};
+
+// What one setting gave on one photo
+struct SweepMeasure
+{
+	int pieces;
+	double area_cv;
+	double ms;
+};
+
+//--- Forward declarations
+int sweep(vector<string>& filenames, int thread_count, int open_method, int expected_pieces, string report_filename);
+void sweep_photo(Mat& src, int photo, int photo_count, SweepGrid& grid, int open_method, int thread_count, vector<Workspace>& workspaces, vector<SweepMeasure>& measures);
+void run_tasks(int task_count, int thread_count, vector<Workspace>& workspaces, function<void(int, Workspace&)> task);
+
+SweepGrid default_sweep_grid();
+int sweep_setting_count(SweepGrid& grid);
+int sweep_index(SweepGrid& grid, int blur, int canny, int close, int filter, int open);
+SegmentParams sweep_params(SweepGrid& grid, int index);
+double area_variation(vector<ContourStats>& stats);
+double elapsed_ms(int64 start);
+//---
+
+// argv should contain the photos to tune the segmenter on. Every setting
+// in the grid is run over every photo and the piece count, how much the
+// piece areas vary and the time taken are reported for each.
+// '-j <threads>' sets the number of threads (all cores by default).
+// '-f' opens the mask with the distance transform method, as Segmenter -f.
+// '-p <pieces>' is the number of pieces actually in each photo, settings
+// are then ranked by how close they get to it.
+// '-o <file>' names the report, one line per setting.
+int main(int argc, char* argv[])
+{
+	int thread_count = max((int)thread::hardware_concurrency(), 1);
+	int open_method = MORPH_OPEN_METHOD_STANDARD;
+	int expected_pieces = 0;
+	string report_filename = DEFAULT_REPORT_FILE;
+	vector<string> filenames;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+		{
+			thread_count = max(atoi(argv[++i]), 1);
+			continue;
+		}
+
+		if (strcmp(argv[i], "-p") == 0 && i + 1 < argc)
+		{
+			expected_pieces = atoi(argv[++i]);
+			continue;
+		}
+
+		if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+		{
+			report_filename = string(argv[++i]);
+			continue;
+		}
+
+		if (strcmp(argv[i], "-f") == 0)
+		{
+			open_method = MORPH_OPEN_METHOD_DISTANCE;
+			continue;
+		}
+
+		filenames.push_back(string(argv[i]));
+	}
+
+	if (filenames.size() == 0)
+	{
+		cout << "Usage: SegmentSweep [-j threads] [-f] [-p pieces] [-o report] photo..." << endl;
+		return EXIT_FAILURE;
+	}
+
+	return sweep(filenames, thread_count, open_method, expected_pieces, report_filename);
+}
+
+// Runs the whole grid over every photo, then writes the report and
+// prints the best settings.
+int sweep(vector<string>& filenames, int thread_count, int open_method, int expected_pieces, string report_filename)
+{
+	SweepGrid grid = default_sweep_grid();
+	int setting_count = sweep_setting_count(grid);
+	int photo_count = filenames.size();
+
+	vector<SweepMeasure> measures (setting_count * photo_count);
+	vector<Workspace> workspaces (thread_count);
+
+	int64 start = getTickCount();
+
+	for (int p = 0; p < photo_count; p++)
+	{
+		Mat src = imread(filenames[p]);
+
+		if (!src.data)
+		{
+			cout << "Error on file '" << filenames[p] << "'. Could not read file." << endl;
+			return EXIT_FAILURE;
+		}
+
+		sweep_photo(src, p, photo_count, grid, open_method, thread_count, workspaces, measures);
+
+		cout << "File '" << filenames[p] << "' - swept " << setting_count << " settings" << endl;
+	}
+
+	double seconds = elapsed_ms(start) / 1000.0;
+
+	// Average each setting over the photos
+	vector<SweepMeasure> totals (setting_count);
+	vector<double> scores (setting_count);
+	vector<int> ranking (setting_count);
+
+	for (int s = 0; s < setting_count; s++)
+	{
+		SweepMeasure& total = totals[s];
+		total.pieces = 0;
+		total.area_cv = 0;
+		total.ms = 0;
+
+		double count_error = 0;
+
+		for (int p = 0; p < photo_count; p++)
+		{
+			SweepMeasure& measure = measures[s * photo_count + p];
+
+			total.pieces += measure.pieces;
+			total.area_cv += measure.area_cv / photo_count;
+			total.ms += measure.ms / photo_count;
+			count_error += abs(measure.pieces - expected_pieces);
+		}
+
+		// Without a known piece count the most even piece sizes win,
+		// settings that found nothing always come last
+		scores[s] = total.pieces == 0 ? HUGE_VAL : total.area_cv;
+		if (expected_pieces > 0) scores[s] += count_error;
+
+		ranking[s] = s;
+	}
+
+	sort(ranking.begin(), ranking.end(), [&](int a, int b) { return scores[a] < scores[b]; });
+
+	fstream fs (report_filename.c_str(), fstream::out);
+	fs << "blur,canny,close,filter,open,pieces,area_cv,ms" << endl;
+
+	for (int s = 0; s < setting_count; s++)
+	{
+		SegmentParams params = sweep_params(grid, s);
+		SweepMeasure& total = totals[s];
+
+		fs << params.blur_size << "," << params.canny_thresholds[0] << "," << params.close_size << ",";
+		fs << params.filter_change_percent << "," << params.open_size << ",";
+		fs << total.pieces << "," << total.area_cv << "," << total.ms << endl;
+	}
+
+	fs.close();
+
+	cout << "Swept " << setting_count << " settings over " << photo_count << " photos on " << thread_count << " threads";
+	cout << " in " << seconds << "s" << endl;
+	cout << "blur\tcanny\tclose\tfilter\topen\tpieces\tarea cv\tms" << endl;
+
+	for (int r = 0; r < min(setting_count, SWEEP_REPORT_TOP); r++)
+	{
+		SegmentParams params = sweep_params(grid, ranking[r]);
+		SweepMeasure& total = totals[ranking[r]];
+
+		cout << params.blur_size << "\t" << params.canny_thresholds[0] << "\t" << params.close_size << "\t";
+		cout << params.filter_change_percent << "\t" << params.open_size << "\t";
+		cout << total.pieces << "\t" << total.area_cv << "\t" << total.ms << endl;
+	}
+
+	cout << "Report written to '" << report_filename << "'" << endl;
+
+	return EXIT_SUCCESS;
+}
+
+// Runs every setting over one photo. Each stage's output is shared by all
+// the settings that only differ in later stages: the channels are blurred
+// once per blur size, canny runs once per threshold on those, the edge
+// map is closed and traced once per close size and so on, so only the
+// open runs once per setting. A setting's time is the sum of the stages
+// on its path, which is what the segmenter would spend with it.
+// The segmenter's resize is skipped, it is a no-op in the default preset.
+void sweep_photo(Mat& src, int photo, int photo_count, SweepGrid& grid, int open_method, int thread_count, vector<Workspace>& workspaces, vector<SweepMeasure>& measures)
+{
+	int blur_count = grid.blur_sizes.size();
+	int canny_count = grid.canny_thresholds.size();
+
+	vector<vector<Mat> > blurred (blur_count);
+	vector<double> blur_ms (blur_count);
+
+	run_tasks(blur_count, thread_count, workspaces, [&](int b, Workspace& workspace)
+	{
+		int64 start = getTickCount();
+		blur_channels(src, blurred[b], grid.blur_sizes[b]);
+		blur_ms[b] = elapsed_ms(start);
+	});
+
+	run_tasks(blur_count * canny_count, thread_count, workspaces, [&](int task, Workspace& workspace)
+	{
+		int b = task / canny_count;
+		int c = task % canny_count;
+		int thresholds[3] = { grid.canny_thresholds[c], grid.canny_thresholds[c], grid.canny_thresholds[c] };
+
+		vector<Mat> edges;
+		Mat& edge_map = workspace.edgeMap();
+
+		int64 start = getTickCount();
+		canny_channels(blurred[b], edges, edge_map, thresholds, grid.blur_sizes[b], workspace);
+		double canny_ms = blur_ms[b] + elapsed_ms(start);
+
+		for (int cl = 0; cl < grid.close_sizes.size(); cl++)
+		{
+			Mat closed = edge_map.clone();
+			vector<vector<Point> > traced;
+			vector<Vec4i> hierarchy;
+
+			start = getTickCount();
+			close_edge_map(closed, grid.close_sizes[cl], workspace);
+			findContours(closed, traced, hierarchy, CV_RETR_EXTERNAL, CV_CHAIN_APPROX_TC89_KCOS, Point(0, 0));
+			double close_ms = canny_ms + elapsed_ms(start);
+
+			// Not the workspace's scratch, open_mask uses that
+			Mat filled;
+
+			for (int f = 0; f < grid.filter_percents.size(); f++)
+			{
+				vector<vector<Point> > contours = traced;
+
+				start = getTickCount();
+				vector<ContourStats> stats = analyse_contours(contours, grid.filter_percents[f]);
+				filter_contours_by_area(contours, stats);
+				fill_contours(filled, src.size(), contours);
+				double filter_ms = close_ms + elapsed_ms(start);
+
+				for (int o = 0; o < grid.open_sizes.size(); o++)
+				{
+					Mat& mask = workspace.mask();
+					filled.copyTo(mask);
+
+					start = getTickCount();
+					open_mask(mask, grid.open_sizes[o], open_method, workspace);
+
+					vector<vector<Point> > pieces;
+					findContours(mask, pieces, hierarchy, CV_RETR_EXTERNAL, CV_CHAIN_APPROX_TC89_KCOS, Point(0, 0));
+
+					vector<ContourStats> piece_stats = analyse_contours(pieces, grid.filter_percents[f]);
+					filter_contours_by_area(pieces, piece_stats);
+					double total_ms = filter_ms + elapsed_ms(start);
+
+					SweepMeasure& measure = measures[sweep_index(grid, b, c, cl, f, o) * photo_count + photo];
+					measure.pieces = pieces.size();
+					measure.area_cv = area_variation(piece_stats);
+					measure.ms = total_ms;
+				}
+			}
+		}
+	});
+}
+
+// Runs task(0) to task(task_count - 1) over a pool of threads, each with
+// its own workspace.
+void run_tasks(int task_count, int thread_count, vector<Workspace>& workspaces, function<void(int, Workspace&)> task)
+{
+	atomic<int> next_task (0);
+	vector<thread> workers;
+
+	for (int t = 0; t < thread_count; t++)
+	{
+		Workspace* workspace = &workspaces[t];
+
+		workers.push_back(thread([&, workspace]()
+		{
+			int i;
+			while ((i = next_task++) < task_count)
+			{
+				task(i, *workspace);
+			}
+		}));
+	}
+
+	for (int t = 0; t < workers.size(); t++)
+	{
+		workers[t].join();
+	}
+}
+
+SweepGrid default_sweep_grid()
+{
+	int blur_sizes[] = SWEEP_BLUR_SIZES;
+	int canny_thresholds[] = SWEEP_CANNY_THRESHOLDS;
+	int close_sizes[] = SWEEP_CLOSE_SIZES;
+	int filter_percents[] = SWEEP_FILTER_PERCENTS;
+	int open_sizes[] = SWEEP_OPEN_SIZES;
+
+	SweepGrid grid;
+	grid.blur_sizes.assign(blur_sizes, blur_sizes + sizeof(blur_sizes) / sizeof(int));
+	grid.canny_thresholds.assign(canny_thresholds, canny_thresholds + sizeof(canny_thresholds) / sizeof(int));
+	grid.close_sizes.assign(close_sizes, close_sizes + sizeof(close_sizes) / sizeof(int));
+	grid.filter_percents.assign(filter_percents, filter_percents + sizeof(filter_percents) / sizeof(int));
+	grid.open_sizes.assign(open_sizes, open_sizes + sizeof(open_sizes) / sizeof(int));
+
+	return grid;
+}
+
+int sweep_setting_count(SweepGrid& grid)
+{
+	return grid.blur_sizes.size() * grid.canny_thresholds.size() * grid.close_sizes.size()
+	     * grid.filter_percents.size() * grid.open_sizes.size();
+}
+
+int sweep_index(SweepGrid& grid, int blur, int canny, int close, int filter, int open)
+{
+	int index = blur;
+	index = index * grid.canny_thresholds.size() + canny;
+	index = index * grid.close_sizes.size() + close;
+	index = index * grid.filter_percents.size() + filter;
+	index = index * grid.open_sizes.size() + open;
+
+	return index;
+}
+
+SegmentParams sweep_params(SweepGrid& grid, int index)
+{
+	SegmentParams params = default_pipeline_config().segment;
+
+	params.open_size = grid.open_sizes[index % grid.open_sizes.size()];
+	index /= grid.open_sizes.size();
+	params.filter_change_percent = grid.filter_percents[index % grid.filter_percents.size()];
+	index /= grid.filter_percents.size();
+	params.close_size = grid.close_sizes[index % grid.close_sizes.size()];
+	index /= grid.close_sizes.size();
+
+	int threshold = grid.canny_thresholds[index % grid.canny_thresholds.size()];
+	params.canny_thresholds[0] = threshold;
+	params.canny_thresholds[1] = threshold;
+	params.canny_thresholds[2] = threshold;
+	index /= grid.canny_thresholds.size();
+
+	params.blur_size = grid.blur_sizes[index];
+
+	return params;
+}
+
+// Coefficient of variation of the piece areas. Pieces of one puzzle are
+// all about the same size, so a low value means few merged or broken
+// pieces.
+double area_variation(vector<ContourStats>& stats)
+{
+	if (stats.size() < 2) return 0;
+
+	double sum = 0;
+	double sum_squares = 0;
+
+	for (int i = 0; i < stats.size(); i++)
+	{
+		sum += stats[i].area;
+		sum_squares += (double)stats[i].area * stats[i].area;
+	}
+
+	double mean = sum / stats.size();
+	double variance = max(sum_squares / stats.size() - mean * mean, 0.0);
+
+	return sqrt(variance) / mean;
+}
+
+double elapsed_ms(int64 start)
+{
+	return (getTickCount() - start) * 1000.0 / getTickFrequency();
+}
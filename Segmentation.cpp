@@ -0,0 +1,154 @@
+#include "Segmentation.h"
+#include "GeometryHelpers.h"
+#include "Morphology.h"
+
+#include <algorithm>
+
+// Splits the image into its colour channels and blurs each one.
+void blur_channels(Mat& src, vector<Mat>& channels, int blur_size)
+{
+	split(src, channels);
+
+	for (int i = 0; i < 3; i++)
+	{
+		blur(channels[i], channels[i], Size(blur_size, blur_size));
+	}
+}
+
+// Runs canny over each blurred channel and combines the results into
+// edge_map. edges can be the blurred channels themselves when they are
+// not needed again.
+void canny_channels(vector<Mat>& blurred, vector<Mat>& edges, Mat& edge_map, const int thresholds[3], int aperture, Workspace& workspace)
+{
+	edges.resize(3);
+
+#ifdef MORPH_CHANNEL
+	Mat& channel_morph_element = workspace.element(MORPH_CHANNEL_ELEM, MORPH_CHANNEL_SIZE);
+#endif
+
+	for (int i = 0; i < 3; i++)
+	{
+		Canny(blurred[i], edges[i], thresholds[i], thresholds[i]*CANNY_RATIO, aperture);
+
+#ifdef MORPH_CHANNEL
+		morphologyEx(edges[i], edges[i], MORPH_CHANNEL_OP, channel_morph_element);
+#endif
+	}
+
+	bitwise_or(edges[0], edges[1], edge_map);
+	bitwise_or(edges[2], edge_map, edge_map);
+}
+
+// Closes small gaps in the edge map so piece borders form closed loops.
+void close_edge_map(Mat& edge_map, int close_size, Workspace& workspace)
+{
+	morphologyEx(edge_map, edge_map, MORPH_CLOSE, workspace.element(MORPH_CLOSE_ELEM, close_size));
+}
+
+// External contours never overlap so they can all be filled in one go
+void fill_contours(Mat& mask, Size size, vector< vector<Point> >& contours)
+{
+	mask.create(size, CV_8UC1);
+	mask.setTo(Scalar(0));
+	drawContours(mask, contours, -1, Scalar(255, 255, 255), -1);
+}
+
+// Opens the piece mask to cut off thin bridges to the background.
+void open_mask(Mat& mask, int open_size, int method, Workspace& workspace)
+{
+	if (method == MORPH_OPEN_METHOD_DISTANCE)
+	{
+		binary_open_distance(mask, mask, open_size, workspace.distance(), workspace.scratch());
+	}
+	else
+	{
+		binary_open_standard(mask, mask, workspace.element(MORPH_ELLIPSE, open_size));
+	}
+}
+
+// Measures every contour in a single pass. Each contour is simplified
+// once to find its bounding rectangle and estimated area, then marked
+// as a piece candidate if it is at least as big as the smallest piece.
+vector<ContourStats> analyse_contours(vector< vector<Point> >& contours, int filter_change_percent)
+{
+	vector<ContourStats> stats (contours.size());
+	vector<int> contour_sizes (contours.size());
+
+	if (contours.size() == 0) return stats;
+
+	for (int i = 0; i < contours.size(); i++)
+	{
+		stats[i].bounding_rect = contour_bounding_rect(contours[i]);
+		stats[i].area = stats[i].bounding_rect.area();
+		contour_sizes[i] = stats[i].area;
+	}
+
+	int min_area = find_min_piece_area(contour_sizes, filter_change_percent);
+
+	for (int i = 0; i < contours.size(); i++)
+	{
+		stats[i].candidate = (stats[i].area >= min_area);
+	}
+
+	return stats;
+}
+
+// Attempts to filter false positives out of the contour list. 
+// False positives contours tend to be small parts of the background
+// so this drops contours analyse_contours found too small to be pieces.
+// The stats list is filtered alongside so the two stay in step.
+void filter_contours_by_area(vector< vector<Point> >& contours, vector<ContourStats>& stats)
+{
+	int kept = 0;
+
+	for (int i = 0; i < contours.size(); i++)
+	{
+		if (!stats[i].candidate) continue;
+
+		if (kept != i)
+		{
+			contours[kept].swap(contours[i]);
+			stats[kept] = stats[i];
+		}
+
+		kept++;
+	}
+
+	contours.resize(kept);
+	stats.resize(kept);
+}
+
+// Looks at contour areas and attempts to find the area of the smallest
+// puzzle piece by ordering all the contours and finding the biggest
+// difference between contours adjacent in the ordered array. A
+// filter_change_percent of 0 turns the filter off, the smallest contour
+// is returned so every contour is kept.
+int find_min_piece_area(vector<int> contour_sizes, int filter_change_percent)
+{
+	sort(contour_sizes.begin(), contour_sizes.end());
+
+	if (filter_change_percent <= 0) return contour_sizes[0];
+
+	int prev_value = contour_sizes[0];
+	int min_value_index = 0;
+	int max_change = -1;
+	for (int i = 1; i < (int)contour_sizes.size() - 4; i++) 
+	{
+		int change = contour_sizes[i] - prev_value;
+
+		if (change > max_change)
+		{
+			max_change = change;
+			min_value_index = i;
+		}
+
+		prev_value = contour_sizes[i];
+	}
+
+	if (min_value_index == 0 || max_change < contour_sizes[min_value_index-1] / filter_change_percent)
+	{
+		return contour_sizes[0];
+	} 
+
+	return contour_sizes[min_value_index];
+}
@@ -0,0 +1,62 @@
+#ifndef _SEGMENTATION_
+#define _SEGMENTATION_
+
+#include "opencv2/imgproc/imgproc.hpp"
+
+#include "Workspace.h"
+
+#define BLUR_KERNEL_SIZE 3
+#define CANNY_RATIO 2
+#define CANNY_THRESHOLD_R 40
+#define CANNY_THRESHOLD_G 40
+#define CANNY_THRESHOLD_B 40
+
+//#define MORPH_CHANNEL
+#define MORPH_CHANNEL_ELEM MORPH_ELLIPSE
+#define MORPH_CHANNEL_SIZE 2
+#define MORPH_CHANNEL_OP MORPH_CLOSE
+
+#define MORPH_CLOSE_ELEM MORPH_RECT
+#define MORPH_CLOSE_SIZE 5
+
+#define MORPH_OPEN_SIZE 25
+
+// Dropping contours smaller than the biggest jump in area is off (0) by
+// default, it can cut real pieces when their sizes spread. SegmentSweep
+// tries it at a few percentages.
+#define FILTER_CHANGE_PERCENT 0
+
+using namespace std;
+using namespace cv;
+
+// The tunable parameters of the segmentation stages. The defaults above
+// make up the "default" pipeline preset, the sweep tool tries a grid of them.
+struct SegmentParams
+{
+	int blur_size;
+	int canny_thresholds[3];
+	int close_size;
+	int open_size;
+	int filter_change_percent;
+};
+
+// Measurements for a single contour, worked out once by analyse_contours
+// and reused by every stage after it.
+struct ContourStats
+{
+	Rect bounding_rect;
+	int area;
+	bool candidate;
+};
+
+void blur_channels(Mat& src, vector<Mat>& channels, int blur_size);
+void canny_channels(vector<Mat>& blurred, vector<Mat>& edges, Mat& edge_map, const int thresholds[3], int aperture, Workspace& workspace);
+void close_edge_map(Mat& edge_map, int close_size, Workspace& workspace);
+void fill_contours(Mat& mask, Size size, vector< vector<Point> >& contours);
+void open_mask(Mat& mask, int open_size, int method, Workspace& workspace);
+
+vector<ContourStats> analyse_contours(vector< vector<Point> >& contours, int filter_change_percent);
+void filter_contours_by_area(vector< vector<Point> >& contours, vector<ContourStats>& stats);
+int find_min_piece_area(vector<int> contour_sizes, int filter_change_percent);
+
+#endif
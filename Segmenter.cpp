@@ -3,124 +3,302 @@
 
 #include "PieceData.h"
 #include "GeometryHelpers.h"
+#include "Morphology.h"
+#include "Workspace.h"
+#include "Segmentation.h"
+#include "PipelineConfig.h"
+#include "EdgeDetector.h"
+#include "PhotoStream.h"
 
 #include <sstream>
 #include <iostream>
 #include <algorithm>
 #include <cstdlib>
+#include <map>
 
-#define RESIZE_DIVIDER 1
-
-#define BLUR_KERNEL_SIZE 3
-#define CANNY_RATIO 2
-#define CANNY_THRESHOLD_R 40
-#define CANNY_THRESHOLD_G 40
-#define CANNY_THRESHOLD_B 40
-
-//#define MORPH_CHANNEL
-#define MORPH_CHANNEL_ELEM MORPH_ELLIPSE
-#define MORPH_CHANNEL_SIZE 2
-#define MORPH_CHANNEL_OP MORPH_CLOSE
-
-#define MORPH_CLOSE_ELEM MORPH_RECT
-#define MORPH_CLOSE_SIZE 5
-
-#define MORPH_OPEN_ELEM MORPH_ELLIPSE
-#define MORPH_OPEN_SIZE 25
+#define MORPH_BENCHMARK_SIZES { 5, 10, 15, 25, 35, 50 }
+#define MORPH_BENCHMARK_RUNS 3
+#define MORPH_EQUIVALENCE_TOLERANCE 0.5
 
 #define SMOOTH_BLUR 0
 #define SMOOTH_EPSILON 1
 
-#define FILTER_CHANGE_PERCENT 15
+#define DETECT_EDGES 0
+#define DETECT_BACKGROUND 1
+#define DETECT_FUSED_EDGES 2
+
+#define BACKGROUND_THRESHOLD 30
 
 #define OUTPUT_FOLDER "output/"
 
 using namespace std;
 using namespace cv;
 
+struct SegmenterOptions
+{
+	bool debug;
+	bool benchmark;
+	int open_method;
+	size_t memory_cap;
+	PipelineConfig config;
+
+	int detect_method;
+	bool background_is_image;
+	Mat background_image;
+	map<pair<int, int>, Mat> background_sizes;
+	Scalar background_colour;
+};
+
 //--- Forward declarations
-int segmenter(string filename, int output_offset, bool debug);
+int segmenter(string filename, int output_offset, SegmenterOptions& options, Workspace& workspace);
+int segment_image(Mat& src_image, string filename, int output_offset, SegmenterOptions& options, Workspace& workspace);
+int stream_segmenter(string source, int output_offset, SegmenterOptions& options, Workspace& workspace);
 
-int find_min_piece_area(vector< vector<Point> >& contours);
-vector<vector<Point> > filter_contours_by_area(vector< vector<Point> >& contours);
 vector<Point> smooth_contour(vector<Point>& contour);
+void edge_detect(Mat& src, Mat& edge_map, SegmentParams& params, Workspace& workspace);
+void fused_edge_detect(Mat& src, Mat& edge_map, SegmentParams& params, Workspace& workspace);
+void background_difference(Mat& src, Mat& diff_map, SegmenterOptions& options, Workspace& workspace);
+void benchmark_open(Mat& mask);
 void display(string window_prefix, string window_name, Mat display_img, double scale);
 //---
 
 
 // argv should contain list of filenames for images to segment
 // and optionally '-v' which will cause debug information to be
-// shown for all images which come after that argument
+// shown for all images which come after that argument.
+// '-f' switches the mask opening to the distance transform method
+// and '-b' benchmarks both opening methods against each other on
+// the mask of every image after it. '-m <megabytes>' caps how much
+// memory the reusable image buffers may hold, an image that needs more is
+// refused (see Workspace). It must come before the filenames.
+// '-r <image>' or '-c <b,g,r>' switch to finding pieces by their difference
+// from a photo of the empty background or from a plain background colour.
+// '-e' uses the single pass fused edge detector instead of per channel canny.
+// '-p <preset>' picks the pipeline preset (default, fast or accurate) for
+// the images after it.
+// '-s <folder>' keeps segmenting photos as they are dropped into the folder
+// and '-s -' does the same for paths read from stdin. Anything after it
+// is ignored.
 int main(int argc, char* argv[])
 {
-	bool debug = false;
+	SegmenterOptions options;
+	options.debug = false;
+	options.benchmark = false;
+	options.open_method = MORPH_OPEN_METHOD_STANDARD;
+	options.memory_cap = 0;
+	options.config = default_pipeline_config();
+	options.detect_method = DETECT_EDGES;
+	options.background_is_image = false;
+
+	for (int i = 1; i < argc - 1; i++)
+	{
+		if (strcmp(argv[i], "-m") == 0)
+		{
+			options.memory_cap = (size_t)atol(argv[i + 1]) * 1024 * 1024;
+		}
+	}
+
+	Workspace workspace (options.memory_cap);
 	int total_piece_count = 0;
 
 	for (int i = 1; i < argc; i++)
 	{
+		if (strcmp(argv[i], "-m") == 0)
+		{
+			i++;
+			continue;
+		}
+
 		if (strcmp(argv[i], "-v") == 0)
 		{
-			debug = true;
+			options.debug = true;
+			continue;
+		}
+
+		if (strcmp(argv[i], "-f") == 0)
+		{
+			options.open_method = MORPH_OPEN_METHOD_DISTANCE;
+			continue;
+		}
+
+		if (strcmp(argv[i], "-b") == 0)
+		{
+			options.benchmark = true;
 			continue;
 		}
 
-		int found_pieces = segmenter(string(argv[i]), total_piece_count, debug);
+		if (strcmp(argv[i], "-p") == 0 && i + 1 < argc)
+		{
+			if (!pipeline_preset(string(argv[++i]), options.config))
+			{
+				cout << "Error on preset '" << argv[i] << "'. Expected one of " << pipeline_preset_names() << "." << endl;
+				return EXIT_FAILURE;
+			}
 
-		if (found_pieces < 0)
+			continue;
+		}
+
+		if (strcmp(argv[i], "-e") == 0)
 		{
-			cout << "Error on file '" << argv[i] << "'. Could not read file." << endl;
-			return EXIT_FAILURE;
+			options.detect_method = DETECT_FUSED_EDGES;
+			continue;
 		}
 
+		if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+		{
+			options.background_image = imread(argv[++i]);
+
+			if (!options.background_image.data)
+			{
+				cout << "Error on background '" << argv[i] << "'. Could not read file." << endl;
+				return EXIT_FAILURE;
+			}
+
+			options.detect_method = DETECT_BACKGROUND;
+			options.background_is_image = true;
+			continue;
+		}
+
+		if (strcmp(argv[i], "-c") == 0 && i + 1 < argc)
+		{
+			int b, g, r;
+
+			if (sscanf(argv[++i], "%d,%d,%d", &b, &g, &r) != 3)
+			{
+				cout << "Error on background colour '" << argv[i] << "'. Expected b,g,r." << endl;
+				return EXIT_FAILURE;
+			}
+
+			options.detect_method = DETECT_BACKGROUND;
+			options.background_is_image = false;
+			options.background_colour = Scalar(b, g, r);
+			continue;
+		}
+
+		if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+		{
+			return stream_segmenter(string(argv[i + 1]), total_piece_count, options, workspace);
+		}
+
+		int found_pieces = segmenter(string(argv[i]), total_piece_count, options, workspace);
+
+		if (found_pieces < 0) return EXIT_FAILURE;
+
 		cout << "File '"<< argv[i] << "' - piece count: " << found_pieces << endl;
 		total_piece_count += found_pieces;
 	}
 
+	if (options.debug)
+	{
+		cout << "Workspace peak: " << workspace.peakUsage() / (1024 * 1024) << "MB, released " << workspace.releaseCount() << " times" << endl;
+	}
+
 	waitKey();
 
 	return EXIT_SUCCESS;
 }
 
-// The segmenter
-int segmenter(string filename, int output_offset, bool debug)
+// Segments photos as the stream hands them over, printing the pieces
+// found and the latency from the photo turning up to its pieces being
+// written. The next photo is decoded while this one is segmented.
+int stream_segmenter(string source, int output_offset, SegmenterOptions& options, Workspace& workspace)
 {
-	Mat src_image = imread(filename);
-	Mat src_resized;
+	PhotoStream stream (source);
+	DecodedPhoto photo;
+
+	int total_piece_count = output_offset;
+	int photo_count = 0;
+	double total_latency = 0;
+
+	if (!stream.start()) return EXIT_FAILURE;
+
+	while (stream.next(photo))
+	{
+		if (!photo.image.data)
+		{
+			cout << "Error on file '" << photo.filename << "'. Could not read file." << endl;
+			continue;
+		}
 
-	if (!src_image.data) { return -1; }
+		int64 segment_start = getTickCount();
+		int found_pieces = segment_image(photo.image, photo.filename, total_piece_count, options, workspace);
+		int64 segment_end = getTickCount();
 
-	resize(src_image, src_resized, Size(src_image.cols/RESIZE_DIVIDER, src_image.rows/RESIZE_DIVIDER), 0, 0, INTER_LINEAR);
+		// Lets the debug windows repaint between photos
+		if (options.debug) waitKey(1);
 
-	vector<Mat> channels;
-	split(src_resized, channels);
+		if (found_pieces < 0) continue;
 
-	vector<int> thresholds (3);
-	thresholds[0] = CANNY_THRESHOLD_B;
-	thresholds[1] = CANNY_THRESHOLD_G;
-	thresholds[2] = CANNY_THRESHOLD_R;
+		double segment_ms = (segment_end - segment_start) * 1000.0 / getTickFrequency();
+		double latency_ms = (segment_end - photo.found_tick) * 1000.0 / getTickFrequency();
 
-#ifdef MORPH_CHANNEL
-	Mat channel_morph_element = getStructuringElement(MORPH_CHANNEL_ELEM, Size(2*MORPH_CHANNEL_SIZE+1, 2*MORPH_CHANNEL_SIZE+1), Point(MORPH_CHANNEL_SIZE, MORPH_CHANNEL_SIZE));
-#endif
+		cout << "File '"<< photo.filename << "' - piece count: " << found_pieces;
+		cout << " - latency: " << latency_ms << "ms (decode " << photo.decode_ms << "ms, segment " << segment_ms << "ms)" << endl;
 
-	for(int i = 0; i < 3; i++)
+		total_piece_count += found_pieces;
+		total_latency += latency_ms;
+		photo_count++;
+	}
+
+	if (photo_count > 0)
 	{
-		blur(channels[i], channels[i], Size(BLUR_KERNEL_SIZE, BLUR_KERNEL_SIZE));
-		Canny(channels[i], channels[i], thresholds[i], thresholds[i]*CANNY_RATIO, BLUR_KERNEL_SIZE);
+		cout << photo_count << " photos, " << (total_piece_count - output_offset) << " pieces, mean latency " << total_latency / photo_count << "ms" << endl;
+	}
 
-#ifdef MORPH_CHANNEL
-		morphologyEx(channels[i], channels[i], MORPH_CHANNEL_OP, channel_morph_element);
-#endif
+	return stream.failed() ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+// The segmenter. -1 if the file can't be read or segmented.
+int segmenter(string filename, int output_offset, SegmenterOptions& options, Workspace& workspace)
+{
+	Mat src_image = imread(filename);
+
+	if (!src_image.data)
+	{
+		cout << "Error on file '" << filename << "'. Could not read file." << endl;
+		return -1;
 	}
 
-	Mat edge_map;
-	edge_map.create(src_image.size(), src_image.type());
+	return segment_image(src_image, filename, output_offset, options, workspace);
+}
 
-	bitwise_or(channels[0], channels[1], edge_map);
-	bitwise_or(channels[2], edge_map, edge_map);
+// Splits an already decoded photo into pieces, writing each one to the
+// output folder numbered from output_offset. Returns the piece count, or
+// -1 if the photo's buffers won't fit under the memory cap.
+int segment_image(Mat& src_image, string filename, int output_offset, SegmenterOptions& options, Workspace& workspace)
+{
+	bool debug = options.debug;
+	SegmentParams& params = options.config.segment;
+	int resize_divider = options.config.resize_divider;
+	Size resized_size (src_image.cols/resize_divider, src_image.rows/resize_divider);
+
+	if (!workspace.begin(src_image.size(), resized_size))
+	{
+		cout << "Error on file '" << filename << "'. Needs " << workspace.projectedUsage(src_image.size(), resized_size) / (1024 * 1024);
+		cout << "MB of image buffers, over the " << workspace.memoryCap() / (1024 * 1024) << "MB cap." << endl;
+		return -1;
+	}
 
-	Mat close_morph_element = getStructuringElement(MORPH_CLOSE_ELEM, Size(2*MORPH_CLOSE_SIZE+1, 2*MORPH_CLOSE_SIZE+1), Point(MORPH_CLOSE_SIZE, MORPH_CLOSE_SIZE));
-	morphologyEx(edge_map, edge_map, MORPH_CLOSE, close_morph_element);
+	Mat& src_resized = workspace.resized();
+
+	resize(src_image, src_resized, resized_size, 0, 0, INTER_LINEAR);
+
+	Mat& edge_map = workspace.edgeMap();
+
+	if (options.detect_method == DETECT_BACKGROUND)
+	{
+		background_difference(src_resized, edge_map, options, workspace);
+	}
+	else if (options.detect_method == DETECT_FUSED_EDGES)
+	{
+		fused_edge_detect(src_resized, edge_map, params, workspace);
+	}
+	else
+	{
+		edge_detect(src_resized, edge_map, params, workspace);
+	}
+
+	close_edge_map(edge_map, params.close_size, workspace);
 
 	if (debug) display(filename, "Edge Map", edge_map, 0.6);
 
@@ -130,22 +308,22 @@ int segmenter(string filename, int output_offset, bool debug)
 	resize(edge_map, edge_map, Size(src_image.cols, src_image.rows), 0, 0, INTER_LINEAR);
 	findContours(edge_map, contours, hierarchy, CV_RETR_EXTERNAL, CV_CHAIN_APPROX_TC89_KCOS, Point(0, 0));
 
-	contours = filter_contours_by_area(contours);
+	vector<ContourStats> stats = analyse_contours(contours, params.filter_change_percent);
+	filter_contours_by_area(contours, stats);
 
-	Mat mask = Mat::zeros(src_image.rows, src_image.cols, CV_8UC1);
-	for (int i = 0; i < contours.size(); i++) 
-	{
-		drawContours(mask, contours, i, Scalar(255, 255, 255), -1);
-	}
+	Mat& mask = workspace.mask();
+	fill_contours(mask, src_image.size(), contours);
+
+	if (options.benchmark) benchmark_open(mask);
 
-	Mat open_morph_element = getStructuringElement(MORPH_OPEN_ELEM, Size(2*MORPH_OPEN_SIZE+1, 2*MORPH_OPEN_SIZE+1), Point(MORPH_OPEN_SIZE, MORPH_OPEN_SIZE));
-	morphologyEx(mask, mask, MORPH_OPEN, open_morph_element);
+	open_mask(mask, params.open_size, options.open_method, workspace);
 
 	if (debug) display(filename, "Mask", mask, 0.6);
 	
 	findContours(mask, contours, hierarchy, CV_RETR_EXTERNAL, CV_CHAIN_APPROX_TC89_KCOS, Point(0, 0));
 
-	contours = filter_contours_by_area(contours);
+	stats = analyse_contours(contours, params.filter_change_percent);
+	filter_contours_by_area(contours, stats);
 
 	if (debug)
 	{
@@ -171,70 +349,63 @@ int segmenter(string filename, int output_offset, bool debug)
 		stringstream output_name;
 		output_name << OUTPUT_FOLDER << (output_offset + i);
 
-		PieceData piece (&src_image, contours[i]);
+		PieceData piece (&src_image, contours[i], stats[i].bounding_rect);
 		piece.write(output_name.str());
 	}
 
+	workspace.finish();
 
 	return contours.size();
 }
 
-// Attempts to filter false positives out of the contour list. 
-// False positives contours tend to be small parts of the background
-// so this filters based on the area of the contours.
-vector< vector<Point> > filter_contours_by_area(vector< vector<Point> >& contours)
+// Finds piece borders by running canny over each colour channel
+// and combining the results.
+void edge_detect(Mat& src, Mat& edge_map, SegmentParams& params, Workspace& workspace)
 {
-	vector< vector<Point> > filter_contours;
-	int min_area = find_min_piece_area(contours);
+	vector<Mat>& channels = workspace.channels();
 
-	for (int i = 0; i < contours.size(); i++)
-	{
-		int area = estimate_contour_area(contours[i]);	
-
-		if (area >= min_area)
-		{
-			filter_contours.push_back(contours[i]);
-		}
-	}
-
-	return filter_contours;
+	blur_channels(src, channels, params.blur_size);
+	canny_channels(channels, channels, edge_map, params.canny_thresholds, params.blur_size, workspace);
 }
 
-// Looks at contours and attempts to find the area of the smallest
-// puzzle piece by ordering all the contours and finding the biggest
-// difference between contours adjacent in the ordered array.
-int find_min_piece_area(vector< vector<Point> >& contours)
+// Same result as edge_detect (to within rounding of the blur) but reads the
+// image once instead of splitting, blurring and running canny per channel.
+// Only supports the 3x3 blur, which BLUR_KERNEL_SIZE is set to.
+void fused_edge_detect(Mat& src, Mat& edge_map, SegmentParams& params, Workspace& workspace)
 {
-	vector<int> contour_sizes (contours.size());
-	for (int i = 0; i < contours.size(); i++)
-	{
-		contour_sizes[i] = estimate_contour_area(contours[i]);
-	}
-
-	sort(contour_sizes.begin(), contour_sizes.end());
+	fused_canny(src, edge_map, params.canny_thresholds, CANNY_RATIO, workspace.gradient(), workspace.direction());
+}
 
-	int prev_value = contour_sizes[0];
-	int min_value_index = 0;
-	int max_change = -1;
-	for (int i = 1; i < contour_sizes.size() - 4; i++) 
+// Finds pieces by how much each pixel differs from the known background,
+// either a photo of the empty rig or a single background colour. A pixel
+// is marked if any channel differs by more than BACKGROUND_THRESHOLD. 
+// Overwrites src with the per channel difference.
+void background_difference(Mat& src, Mat& diff_map, SegmenterOptions& options, Workspace& workspace)
+{
+	if (options.background_is_image)
 	{
-		int change = contour_sizes[i] - prev_value;
+		// Scaled from the original once for each photo size, then reused
+		Mat& background = options.background_sizes[make_pair(src.cols, src.rows)];
 
-		if (change > max_change)
+		if (background.size() != src.size())
 		{
-			max_change = change;
-			min_value_index;
+			resize(options.background_image, background, src.size(), 0, 0, INTER_LINEAR);
 		}
 
-		prev_value = contour_sizes[i];
+		absdiff(src, background, src);
 	}
-
-	if (min_value_index == 0 || max_change < contour_sizes[min_value_index-1] / FILTER_CHANGE_PERCENT)
+	else
 	{
-		return contour_sizes[0];
-	} 
+		absdiff(src, options.background_colour, src);
+	}
+
+	vector<Mat>& channels = workspace.channels();
+	split(src, channels);
+
+	cv::max(channels[0], channels[1], diff_map);
+	cv::max(channels[2], diff_map, diff_map);
 
-	return contour_sizes[min_value_index];
+	threshold(diff_map, diff_map, BACKGROUND_THRESHOLD, 255, THRESH_BINARY);
 }
 
 // Smooths the contour area using a constant epsilon value.
@@ -260,6 +431,45 @@ vector<Point> smooth_contour(vector<Point>& contour)
 	return smoothed_contour;
 }
 
+// Times both mask opening methods over a range of kernel sizes and
+// checks the fast method gives (nearly) the same mask as the reference.
+void benchmark_open(Mat& mask)
+{
+	int sizes[] = MORPH_BENCHMARK_SIZES;
+	int size_count = sizeof(sizes) / sizeof(sizes[0]);
+	int foreground = max(countNonZero(mask), 1);
+
+	cout << "Open benchmark (" << mask.cols << "x" << mask.rows << ")" << endl;
+	cout << "size\tstandard ms\tdistance ms\tdiff %" << endl;
+
+	for (int i = 0; i < size_count; i++)
+	{
+		Mat standard_result;
+		Mat distance_result;
+		Mat difference;
+
+		int64 start = getTickCount();
+		for (int r = 0; r < MORPH_BENCHMARK_RUNS; r++)
+		{
+			binary_open_standard(mask, standard_result, sizes[i]);
+		}
+		double standard_ms = (getTickCount() - start) * 1000.0 / getTickFrequency() / MORPH_BENCHMARK_RUNS;
+
+		start = getTickCount();
+		for (int r = 0; r < MORPH_BENCHMARK_RUNS; r++)
+		{
+			binary_open_distance(mask, distance_result, sizes[i]);
+		}
+		double distance_ms = (getTickCount() - start) * 1000.0 / getTickFrequency() / MORPH_BENCHMARK_RUNS;
+
+		bitwise_xor(standard_result, distance_result, difference);
+		double diff_percent = countNonZero(difference) * 100.0 / foreground;
+
+		cout << sizes[i] << "\t" << standard_ms << "\t\t" << distance_ms << "\t\t" << diff_percent;
+		if (diff_percent > MORPH_EQUIVALENCE_TOLERANCE) cout << "\tMISMATCH";
+		cout << endl;
+	}
+}
 
 void display(string window_prefix, string window_name, Mat display_img, double scale)
 {
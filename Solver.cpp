@@ -0,0 +1,588 @@
+#include "opencv2/core/core.hpp"
+
+#include <iostream>
+#include <algorithm>
+#include <string>
+#include <fstream>
+#include <cstdlib>
+#include <cstring>
+#include <queue>
+#include <unordered_map>
+
+#include "PieceData.h"
+#include "EdgeScores.h"
+#include "Assembly.h"
+#include "Frame.h"
+#include "OccupancyGrid.h"
+
+// How many of a placed edge's best unplaced candidates are tried for
+// the slot next to it
+#define SOLVER_CANDIDATES 8
+
+#define DEFAULT_SOLUTION_FILE "solution.txt"
+
+// Occupancy cells across a slot, a slot being the mean piece side
+#define OCCUPANCY_CELLS_PER_SLOT 16
+
+// The fraction of a piece's cells that may land on pieces already placed
+#define OVERLAP_TOLERANCE 0.1
+
+using namespace std;
+using namespace cv;
+
+// The best piece found for an empty slot. version goes stale when the
+// slot is rescored so old queue entries can be skipped.
+struct SlotCandidate
+{
+	bool buddies;
+	double cost;
+	int x;
+	int y;
+	int piece;
+	int rotation;
+	int version;
+};
+
+// Orders the queue: slots where the piece is a best buddy of all its
+// neighbours first, then lowest cost
+struct SlotCandidateWorse
+{
+	bool operator()(const SlotCandidate& a, const SlotCandidate& b) const
+	{
+		if (a.buddies != b.buddies) return b.buddies;
+		return a.cost > b.cost;
+	}
+};
+
+typedef priority_queue<SlotCandidate, vector<SlotCandidate>, SlotCandidateWorse> SlotQueue;
+
+struct SolverStats
+{
+	int placements;
+	int rescores;
+	int stale_pops;
+	int max_queue_size;
+};
+
+// Piece outlines laid out on an occupancy grid as they are placed, used
+// with -k to turn down placements that would overlap. masks holds each
+// piece's rotations at piece * EDGE_COUNT + rotation, and slots is the
+// range of slots the grid covers, its top left slot at the grid's origin.
+struct SolverGeometry
+{
+	vector<PieceMask> masks;
+	OccupancyGrid* grid;
+	Rect slots;
+	int rejected;
+};
+
+//--- Forward declarations
+int solver(string scores_filename, string solution_filename, bool frame_first, bool check_overlap);
+void greedy_place(EdgeScores& scores, Assembly& assembly, SolverGeometry* geometry, SolverStats& stats);
+void queue_neighbour_slots(EdgeScores& scores, Assembly& assembly, SolverGeometry* geometry, int x, int y, SlotQueue& queue, unordered_map<long long, int>& versions);
+bool evaluate_slot(EdgeScores& scores, Assembly& assembly, SolverGeometry* geometry, int x, int y, SlotCandidate& best);
+bool placement_cost(EdgeScores& scores, Assembly& assembly, int x, int y, int piece, int rotation, double& cost, bool& buddies);
+int start_piece(EdgeScores& scores);
+void write_solution(EdgeScores& scores, Assembly& assembly, string solution_filename);
+bool load_geometry(EdgeScores& scores, SolverGeometry& geometry);
+void size_grid(SolverGeometry& geometry, Rect slots);
+void grid_place(SolverGeometry& geometry, Assembly& assembly, int piece, int x, int y, int rotation);
+Point slot_cell(SolverGeometry& geometry, int x, int y);
+bool overlaps(SolverGeometry& geometry, int piece, int x, int y, int rotation);
+void place_piece(Assembly& assembly, SolverGeometry* geometry, int piece, int x, int y, int rotation);
+int count_holes(Assembly& assembly, SolverGeometry& geometry);
+//---
+
+// argv should contain the scores file written by EdgeMatcher -a.
+// '-o <file>' names the solution file, one line per placed piece with its
+// name, column, row and rotation (quarter turns anticlockwise).
+// '-g' skips solving the frame first and grows the whole puzzle greedily.
+// '-k' loads the pieces named in the scores file and turns down placements
+// whose outline would overlap pieces already placed.
+int main(int argc, char* argv[])
+{
+	string solution_filename = DEFAULT_SOLUTION_FILE;
+	string scores_filename;
+	bool frame_first = true;
+	bool check_overlap = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+		{
+			solution_filename = string(argv[++i]);
+			continue;
+		}
+
+		if (strcmp(argv[i], "-g") == 0)
+		{
+			frame_first = false;
+			continue;
+		}
+
+		if (strcmp(argv[i], "-k") == 0)
+		{
+			check_overlap = true;
+			continue;
+		}
+
+		scores_filename = string(argv[i]);
+	}
+
+	if (scores_filename.size() == 0)
+	{
+		cout << "Usage: Solver [-g] [-k] [-o solution] scores" << endl;
+		return EXIT_FAILURE;
+	}
+
+	return solver(scores_filename, solution_filename, frame_first, check_overlap);
+}
+
+int solver(string scores_filename, string solution_filename, bool frame_first, bool check_overlap)
+{
+	int64 start = getTickCount();
+
+	EdgeScores* scores;
+
+	try
+	{
+		scores = new EdgeScores(scores_filename);
+	}
+	catch (runtime_error& e)
+	{
+		cout << "Error on scores '" << scores_filename << "'. " << e.what() << "." << endl;
+		return EXIT_FAILURE;
+	}
+
+	double load_seconds = (getTickCount() - start) / getTickFrequency();
+
+	Assembly assembly (scores->pieceCount());
+	SolverStats stats = { 0, 0, 0, 0 };
+	SolverGeometry geometry;
+	geometry.grid = NULL;
+
+	if (check_overlap && !load_geometry(*scores, geometry))
+	{
+		delete scores;
+		return EXIT_FAILURE;
+	}
+
+	SolverGeometry* use_geometry = check_overlap ? &geometry : NULL;
+
+	FrameStats frame;
+	bool framed = false;
+	double frame_seconds = 0;
+
+	if (frame_first)
+	{
+		start = getTickCount();
+		framed = solve_frame(*scores, assembly, frame);
+		frame_seconds = (getTickCount() - start) / getTickFrequency();
+	}
+
+	if (use_geometry)
+	{
+		// A solved frame bounds the whole puzzle, otherwise the grid
+		// starts out big enough for a square puzzle grown from any slot
+		// and grows if the puzzle doesn't fit
+		int side = (int)ceil(sqrt((double)scores->pieceCount()));
+		size_grid(geometry, framed ? Rect(0, 0, frame.width, frame.height) : Rect(-side, -side, 2 * side + 1, 2 * side + 1));
+
+		for (int i = 0; i < assembly.placements().size(); i++)
+		{
+			Placement& placement = assembly.placements()[i];
+			grid_place(geometry, assembly, placement.piece, placement.x, placement.y, placement.rotation);
+		}
+	}
+
+	start = getTickCount();
+	greedy_place(*scores, assembly, use_geometry, stats);
+	double seconds = (getTickCount() - start) / getTickFrequency();
+
+	write_solution(*scores, assembly, solution_filename);
+
+	cout << "Loaded " << scores->pieceCount() << " pieces in " << load_seconds << "s" << endl;
+
+	if (framed)
+	{
+		cout << "Frame " << frame.width << "x" << frame.height << " from " << frame.corners << " corners and ";
+		cout << frame.borders << " border pieces, cost " << frame.cost << ", solved in " << frame_seconds << "s" << endl;
+	}
+	else if (frame_first)
+	{
+		cout << "No frame from " << frame.corners << " corners and " << frame.borders << " border pieces, ";
+		cout << "placing greedily" << endl;
+	}
+
+	cout << "Placed " << assembly.placedCount() << " of " << scores->pieceCount() << " pieces in " << seconds << "s, ";
+	cout << (seconds > 0 ? stats.placements / seconds : 0) << " placements/s" << endl;
+	cout << "Queue peak " << stats.max_queue_size << ", " << stats.rescores << " slots rescored, ";
+	cout << stats.stale_pops << " stale entries skipped" << endl;
+
+	if (use_geometry)
+	{
+		cout << "Overlap turned down " << geometry.rejected << " placements, ";
+		cout << count_holes(assembly, geometry) << " holes left in the solved area" << endl;
+	}
+
+	cout << "Solution written to '" << solution_filename << "'" << endl;
+
+	bool complete = (assembly.placedCount() == scores->pieceCount());
+
+	delete geometry.grid;
+	delete scores;
+
+	return complete ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Places pieces one at a time into whichever open slot has the best
+// candidate, best buddy fits before anything else. Grows from the pieces
+// already placed (the frame) or else from start_piece. Every open slot
+// has its best candidate in the queue. Placing a piece only rescores the
+// empty slots around it, entries made stale by that (or whose piece has
+// since been used elsewhere) are dropped or rescored when they reach the
+// top.
+void greedy_place(EdgeScores& scores, Assembly& assembly, SolverGeometry* geometry, SolverStats& stats)
+{
+	if (scores.pieceCount() == 0) return;
+
+	SlotQueue queue;
+	unordered_map<long long, int> versions;
+
+	if (assembly.placedCount() == 0)
+	{
+		place_piece(assembly, geometry, start_piece(scores), 0, 0, 0);
+		stats.placements++;
+	}
+
+	vector<Placement> seeds = assembly.placements();
+	for (int i = 0; i < seeds.size(); i++)
+	{
+		queue_neighbour_slots(scores, assembly, geometry, seeds[i].x, seeds[i].y, queue, versions);
+	}
+
+	while (!queue.empty() && assembly.placedCount() < scores.pieceCount())
+	{
+		stats.max_queue_size = max(stats.max_queue_size, (int)queue.size());
+
+		SlotCandidate candidate = queue.top();
+		queue.pop();
+
+		long long key = cell_key(candidate.x, candidate.y);
+
+		if (assembly.occupied(candidate.x, candidate.y) || versions[key] != candidate.version)
+		{
+			stats.stale_pops++;
+			continue;
+		}
+
+		if (assembly.placed(candidate.piece))
+		{
+			SlotCandidate rescored;
+			stats.rescores++;
+
+			if (evaluate_slot(scores, assembly, geometry, candidate.x, candidate.y, rescored))
+			{
+				rescored.version = ++versions[key];
+				queue.push(rescored);
+			}
+
+			continue;
+		}
+
+		place_piece(assembly, geometry, candidate.piece, candidate.x, candidate.y, candidate.rotation);
+		stats.placements++;
+
+		queue_neighbour_slots(scores, assembly, geometry, candidate.x, candidate.y, queue, versions);
+	}
+}
+
+// Rescores the empty slots around (x, y), each getting a new version.
+void queue_neighbour_slots(EdgeScores& scores, Assembly& assembly, SolverGeometry* geometry, int x, int y, SlotQueue& queue, unordered_map<long long, int>& versions)
+{
+	for (int d = 0; d < EDGE_COUNT; d++)
+	{
+		Point offset = direction_offset(d);
+		int nx = x + offset.x;
+		int ny = y + offset.y;
+
+		if (assembly.occupied(nx, ny)) continue;
+
+		long long key = cell_key(nx, ny);
+		int version = ++versions[key];
+
+		SlotCandidate best;
+		if (!evaluate_slot(scores, assembly, geometry, nx, ny, best)) continue;
+
+		best.version = version;
+		queue.push(best);
+	}
+}
+
+// Finds the best unplaced piece and rotation for an empty slot from the
+// candidates of the edges facing it. False if nothing fits, such as
+// when a flat edge faces the slot or every candidate would overlap.
+bool evaluate_slot(EdgeScores& scores, Assembly& assembly, SolverGeometry* geometry, int x, int y, SlotCandidate& best)
+{
+	bool found = false;
+
+	for (int d = 0; d < EDGE_COUNT; d++)
+	{
+		Point offset = direction_offset(d);
+		int neighbour_edge = assembly.facingEdge(x + offset.x, y + offset.y, opposite_direction(d));
+
+		if (neighbour_edge < 0) continue;
+
+		EdgeCandidate* candidates = scores.candidates(neighbour_edge);
+		int tried = 0;
+
+		for (int c = 0; c < scores.candidateCount(neighbour_edge) && tried < SOLVER_CANDIDATES; c++)
+		{
+			int piece = EDGE_PIECE(candidates[c].edge);
+			if (assembly.placed(piece)) continue;
+
+			tried++;
+
+			// Turn the piece so the candidate edge faces the neighbour
+			int rotation = (d - EDGE_INDEX(candidates[c].edge) + EDGE_COUNT) % EDGE_COUNT;
+
+			double cost;
+			bool buddies;
+			if (!placement_cost(scores, assembly, x, y, piece, rotation, cost, buddies)) continue;
+
+			if (geometry && overlaps(*geometry, piece, x, y, rotation))
+			{
+				geometry->rejected++;
+				continue;
+			}
+
+			SlotCandidate candidate = { buddies, cost, x, y, piece, rotation, 0 };
+
+			if (!found || SlotCandidateWorse()(best, candidate))
+			{
+				best = candidate;
+				found = true;
+			}
+		}
+	}
+
+	return found;
+}
+
+// The average score of the piece against every neighbour of the slot,
+// false if any edge pair can't fit. buddies is set if every pair is a
+// best buddy pair.
+bool placement_cost(EdgeScores& scores, Assembly& assembly, int x, int y, int piece, int rotation, double& cost, bool& buddies)
+{
+	double total = 0;
+	int neighbours = 0;
+	buddies = true;
+
+	for (int d = 0; d < EDGE_COUNT; d++)
+	{
+		Point offset = direction_offset(d);
+		int neighbour_edge = assembly.facingEdge(x + offset.x, y + offset.y, opposite_direction(d));
+
+		if (neighbour_edge < 0) continue;
+
+		int edge = EDGE_ID(piece, (d - rotation + EDGE_COUNT) % EDGE_COUNT);
+		double edge_score = scores.score(edge, neighbour_edge);
+
+		if (edge_score == NO_SCORE) return false;
+
+		total += edge_score;
+		neighbours++;
+		buddies = buddies && scores.bestBuddy(edge) == neighbour_edge;
+	}
+
+	cost = total / neighbours;
+	return true;
+}
+
+// The piece with the most best buddy edges, it is most likely to be
+// surrounded by confident placements.
+int start_piece(EdgeScores& scores)
+{
+	int best_piece = 0;
+	int best_count = -1;
+
+	for (int p = 0; p < scores.pieceCount(); p++)
+	{
+		int count = 0;
+
+		for (int e = 0; e < EDGE_COUNT; e++)
+		{
+			if (scores.bestBuddy(EDGE_ID(p, e)) >= 0) count++;
+		}
+
+		if (count > best_count)
+		{
+			best_count = count;
+			best_piece = p;
+		}
+	}
+
+	return best_piece;
+}
+
+// Writes each placed piece's name, column, row and rotation, moved so
+// the top left slot is (0, 0).
+void write_solution(EdgeScores& scores, Assembly& assembly, string solution_filename)
+{
+	vector<Placement>& placements = assembly.placements();
+
+	int min_x = 0;
+	int min_y = 0;
+	for (int i = 0; i < placements.size(); i++)
+	{
+		min_x = min(min_x, placements[i].x);
+		min_y = min(min_y, placements[i].y);
+	}
+
+	fstream fs (solution_filename.c_str(), fstream::out);
+
+	for (int i = 0; i < placements.size(); i++)
+	{
+		Placement& placement = placements[i];
+
+		fs << scores.pieceName(placement.piece) << " " << placement.x - min_x << " " << placement.y - min_y;
+		fs << " " << placement.rotation << endl;
+	}
+
+	fs.close();
+}
+
+// Loads every piece named in the scores file and builds its masks. The
+// grid is sized once the frame is known, see size_grid.
+bool load_geometry(EdgeScores& scores, SolverGeometry& geometry)
+{
+	int piece_count = scores.pieceCount();
+	vector<PieceData> pieces (piece_count);
+	double side_total = 0;
+
+	for (int p = 0; p < piece_count; p++)
+	{
+		try
+		{
+			pieces[p] = PieceData(scores.pieceName(p));
+		}
+		catch (runtime_error& e)
+		{
+			cout << "Error on piece '" << scores.pieceName(p) << "'. " << e.what() << "." << endl;
+			return false;
+		}
+
+		side_total += piece_side_length(pieces[p]);
+	}
+
+	double cell_size = side_total / piece_count / OCCUPANCY_CELLS_PER_SLOT;
+
+	geometry.masks.resize(piece_count * EDGE_COUNT);
+	for (int p = 0; p < piece_count; p++)
+	{
+		build_piece_masks(pieces[p], cell_size, &geometry.masks[p * EDGE_COUNT]);
+	}
+
+	geometry.rejected = 0;
+
+	return true;
+}
+
+// A new, empty grid covering the slots with a slot spare all round for
+// the tabs of the pieces along their edges.
+void size_grid(SolverGeometry& geometry, Rect slots)
+{
+	delete geometry.grid;
+
+	geometry.slots = Rect(slots.x - 1, slots.y - 1, slots.width + 2, slots.height + 2);
+	geometry.grid = new OccupancyGrid(geometry.slots.width * OCCUPANCY_CELLS_PER_SLOT, geometry.slots.height * OCCUPANCY_CELLS_PER_SLOT);
+}
+
+// Puts the piece, already placed in the assembly, on the grid. A slot
+// off the grid's inner slots grows the grid to twice the placed area and
+// puts every placed piece back on, so no piece is ever dropped (the grid
+// counts cells off it as empty).
+void grid_place(SolverGeometry& geometry, Assembly& assembly, int piece, int x, int y, int rotation)
+{
+	Rect inner (geometry.slots.x + 1, geometry.slots.y + 1, geometry.slots.width - 2, geometry.slots.height - 2);
+
+	if (inner.contains(Point(x, y)))
+	{
+		Point cell = slot_cell(geometry, x, y);
+		geometry.grid->place(geometry.masks[piece * EDGE_COUNT + rotation], cell.x, cell.y);
+		return;
+	}
+
+	Rect placed = inner | Rect(x, y, 1, 1);
+	size_grid(geometry, Rect(placed.x - placed.width / 2, placed.y - placed.height / 2, 2 * placed.width, 2 * placed.height));
+
+	vector<Placement>& placements = assembly.placements();
+
+	for (int i = 0; i < placements.size(); i++)
+	{
+		Point cell = slot_cell(geometry, placements[i].x, placements[i].y);
+		geometry.grid->place(geometry.masks[placements[i].piece * EDGE_COUNT + placements[i].rotation], cell.x, cell.y);
+	}
+}
+
+// The grid cell at the centre of a slot.
+Point slot_cell(SolverGeometry& geometry, int x, int y)
+{
+	return Point((x - geometry.slots.x) * OCCUPANCY_CELLS_PER_SLOT + OCCUPANCY_CELLS_PER_SLOT / 2,
+		(y - geometry.slots.y) * OCCUPANCY_CELLS_PER_SLOT + OCCUPANCY_CELLS_PER_SLOT / 2);
+}
+
+// Whether the piece would cover more than OVERLAP_TOLERANCE of its cells
+// that are already filled.
+bool overlaps(SolverGeometry& geometry, int piece, int x, int y, int rotation)
+{
+	PieceMask& mask = geometry.masks[piece * EDGE_COUNT + rotation];
+	Point cell = slot_cell(geometry, x, y);
+
+	return geometry.grid->overlap(mask, cell.x, cell.y) > mask.area * OVERLAP_TOLERANCE;
+}
+
+// Places the piece in the assembly, and on the grid when there is one.
+void place_piece(Assembly& assembly, SolverGeometry* geometry, int piece, int x, int y, int rotation)
+{
+	assembly.place(piece, x, y, rotation);
+
+	if (geometry) grid_place(*geometry, assembly, piece, x, y, rotation);
+}
+
+// Empty slots inside the bounds of the placed pieces whose middle (half a
+// slot across) is still mostly uncovered.
+int count_holes(Assembly& assembly, SolverGeometry& geometry)
+{
+	vector<Placement>& placements = assembly.placements();
+	if (placements.size() == 0) return 0;
+
+	int min_x = placements[0].x, max_x = placements[0].x;
+	int min_y = placements[0].y, max_y = placements[0].y;
+
+	for (int i = 1; i < placements.size(); i++)
+	{
+		min_x = min(min_x, placements[i].x);
+		max_x = max(max_x, placements[i].x);
+		min_y = min(min_y, placements[i].y);
+		max_y = max(max_y, placements[i].y);
+	}
+
+	int half = OCCUPANCY_CELLS_PER_SLOT / 2;
+	int holes = 0;
+
+	for (int y = min_y; y <= max_y; y++)
+	{
+		for (int x = min_x; x <= max_x; x++)
+		{
+			if (assembly.occupied(x, y)) continue;
+
+			Point cell = slot_cell(geometry, x, y);
+			Rect middle (cell.x - half / 2, cell.y - half / 2, half, half);
+
+			if (geometry.grid->gaps(middle) * 2 > middle.area()) holes++;
+		}
+	}
+
+	return holes;
+}
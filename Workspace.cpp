@@ -0,0 +1,177 @@
+#include "Workspace.h"
+
+size_t mat_bytes(Mat& m)
+{
+	return m.total() * m.elemSize();
+}
+
+Workspace::Workspace(size_t memory_cap) : m_channels(3)
+{
+	m_memoryCap = memory_cap;
+	m_peakUsage = 0;
+	m_releaseCount = 0;
+}
+
+Mat& Workspace::resized()
+{
+	return m_resized;
+}
+
+vector<Mat>& Workspace::channels()
+{
+	return m_channels;
+}
+
+Mat& Workspace::edgeMap()
+{
+	return m_edgeMap;
+}
+
+Mat& Workspace::mask()
+{
+	return m_mask;
+}
+
+Mat& Workspace::distance()
+{
+	return m_distance;
+}
+
+Mat& Workspace::scratch()
+{
+	return m_scratch;
+}
+
+Mat& Workspace::gradient()
+{
+	return m_gradient;
+}
+
+Mat& Workspace::direction()
+{
+	return m_direction;
+}
+
+// Structuring elements are built the first time they are asked for
+// and then kept for the life of the workspace.
+Mat& Workspace::element(int shape, int size)
+{
+	pair<int, int> key (shape, size);
+	map<pair<int, int>, Mat>::iterator it = m_elements.find(key);
+
+	if (it != m_elements.end()) return it->second;
+
+	Mat element = getStructuringElement(shape, Size(2*size+1, 2*size+1), Point(size, size));
+	m_elements[key] = element;
+
+	return m_elements[key];
+}
+
+// Called before an image is processed, with its full size and the size
+// it is resized to. False if its buffers wouldn't fit under the memory
+// cap. Buffers sized for another image are replaced one at a time, which
+// could briefly hold both sizes, so they are dropped first when both
+// together would go over the cap.
+bool Workspace::begin(Size full_size, Size resized_size)
+{
+	if (m_memoryCap == 0) return true;
+
+	size_t needed = projectedUsage(full_size, resized_size);
+
+	if (needed > m_memoryCap) return false;
+
+	bool same_size = (full_size == m_fullSize && resized_size == m_resizedSize);
+
+	if (!same_size && memoryUsage() + needed > m_memoryCap) release();
+
+	m_fullSize = full_size;
+	m_resizedSize = resized_size;
+
+	return true;
+}
+
+// Called once an image has been fully processed. Keeps track of the
+// high water mark.
+void Workspace::finish()
+{
+	size_t usage = memoryUsage();
+
+	if (usage > m_peakUsage) m_peakUsage = usage;
+}
+
+// Frees the image buffers. Structuring elements are tiny so they stay.
+void Workspace::release()
+{
+	m_resized.release();
+	m_edgeMap.release();
+	m_mask.release();
+	m_distance.release();
+	m_scratch.release();
+	m_gradient.release();
+	m_direction.release();
+
+	for (int i = 0; i < m_channels.size(); i++)
+	{
+		m_channels[i].release();
+	}
+
+	m_fullSize = Size();
+	m_resizedSize = Size();
+	m_releaseCount++;
+}
+
+size_t Workspace::memoryUsage()
+{
+	size_t usage = mat_bytes(m_resized) + mat_bytes(m_edgeMap) + mat_bytes(m_mask) + mat_bytes(m_distance) + mat_bytes(m_scratch);
+	usage += mat_bytes(m_gradient) + mat_bytes(m_direction);
+
+	for (int i = 0; i < m_channels.size(); i++)
+	{
+		usage += mat_bytes(m_channels[i]);
+	}
+
+	map<pair<int, int>, Mat>::iterator it;
+	for (it = m_elements.begin(); it != m_elements.end(); it++)
+	{
+		usage += mat_bytes(it->second);
+	}
+
+	return usage;
+}
+
+// The most the buffers can hold for an image of this size, whichever
+// detector and opening method are used. At the resized size: the colour
+// image, its channels, the fused detector's float response and direction
+// and the edge map before it is scaled up. At full size: the edge map,
+// mask, float distance and erosion scratch.
+size_t Workspace::projectedUsage(Size full_size, Size resized_size)
+{
+	size_t resized_pixels = (size_t)resized_size.width * resized_size.height;
+	size_t full_pixels = (size_t)full_size.width * full_size.height;
+
+	size_t usage = resized_pixels * (3 + 3 + sizeof(float) + 1 + 1);
+	usage += full_pixels * (1 + 1 + sizeof(float) + 1);
+
+	map<pair<int, int>, Mat>::iterator it;
+	for (it = m_elements.begin(); it != m_elements.end(); it++)
+	{
+		usage += mat_bytes(it->second);
+	}
+
+	return usage;
+}
+
+size_t Workspace::peakUsage()
+{
+	return m_peakUsage;
+}
+
+size_t Workspace::memoryCap()
+{
+	return m_memoryCap;
+}
+
+int Workspace::releaseCount()
+{
+	return m_releaseCount;
+}
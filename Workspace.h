@@ -0,0 +1,69 @@
+#ifndef _WORKSPACE_
+#define _WORKSPACE_
+
+#include "opencv2/imgproc/imgproc.hpp"
+
+#include <vector>
+#include <map>
+#include <utility>
+
+using namespace std;
+using namespace cv;
+
+// Holds the full size buffers and structuring elements the segmenter
+// needs so they can be reused from one image to the next instead of being
+// allocated and freed for every photo. OpenCV only reallocates a Mat when
+// the requested size or type changes, so a run over same sized photos
+// settles on a fixed set of buffers.
+//
+// If a memory cap is given (in bytes) each image's buffers are projected
+// before any is allocated (see begin). An image whose buffers can't fit
+// under the cap is refused, and buffers left from an image of another size
+// are dropped first if keeping them could go over it, so the buffers never
+// hold more than the cap. The decoded photo itself, contours and the
+// pieces written out are not counted.
+class Workspace
+{
+	private:
+		Mat m_resized;
+		vector<Mat> m_channels;
+		Mat m_edgeMap;
+		Mat m_mask;
+		Mat m_distance;
+		Mat m_scratch;
+		Mat m_gradient;
+		Mat m_direction;
+		map<pair<int, int>, Mat> m_elements;
+
+		Size m_fullSize;
+		Size m_resizedSize;
+
+		size_t m_memoryCap;
+		size_t m_peakUsage;
+		int m_releaseCount;
+
+	public:
+		Workspace(size_t memory_cap = 0);
+
+		Mat& resized();
+		vector<Mat>& channels();
+		Mat& edgeMap();
+		Mat& mask();
+		Mat& distance();
+		Mat& scratch();
+		Mat& gradient();
+		Mat& direction();
+		Mat& element(int shape, int size);
+
+		bool begin(Size full_size, Size resized_size);
+		void finish();
+		void release();
+
+		size_t memoryUsage();
+		size_t projectedUsage(Size full_size, Size resized_size);
+		size_t peakUsage();
+		size_t memoryCap();
+		int releaseCount();
+};
+
+#endif
@@ -0,0 +1,45 @@
+#!/bin/sh
+# Checks that sharded matching gives the same candidate graph as a single
+# run: scores the pieces with EdgeMatcher -k over n shards, merges them
+# with MatchMerge and compares the result byte for byte with one -k run.
+# BIN names the directory holding the programs (the build directory).
+#
+#	check_shards.sh [-k top_k] [-n shards] piece...
+
+BIN=${BIN:-.}
+TOP_K=16
+SHARDS=4
+
+while [ $# -gt 0 ]; do
+	case "$1" in
+		-k) TOP_K=$2; shift 2 ;;
+		-n) SHARDS=$2; shift 2 ;;
+		*) break ;;
+	esac
+done
+
+if [ $# -eq 0 ]; then
+	echo "Usage: check_shards.sh [-k top_k] [-n shards] piece..."
+	exit 1
+fi
+
+WORK=$(mktemp -d) || exit 1
+trap 'rm -rf "$WORK"' EXIT
+
+PARTS=""
+i=0
+while [ $i -lt $SHARDS ]; do
+	"$BIN/EdgeMatcher" -k $TOP_K -s $i/$SHARDS -a "$WORK/part$i.txt" "$@" > /dev/null || exit 1
+	PARTS="$PARTS $WORK/part$i.txt"
+	i=$((i + 1))
+done
+
+"$BIN/MatchMerge" -o "$WORK/merged.txt" $PARTS > /dev/null || exit 1
+"$BIN/EdgeMatcher" -k $TOP_K -a "$WORK/single.txt" "$@" > /dev/null || exit 1
+
+if cmp "$WORK/merged.txt" "$WORK/single.txt"; then
+	echo "Merged $SHARDS shards match a single run"
+else
+	echo "Merged $SHARDS shards differ from a single run"
+	exit 1
+fi